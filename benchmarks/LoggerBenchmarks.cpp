@@ -0,0 +1,422 @@
+// Latency percentiles and multi-thread throughput of the logging calls for every output.
+// Results are written to LoggerBenchmarks.json unless --benchmark_out is given, the
+// console summary goes to stderr because cout is one of the measured outputs.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+struct sBenchObject
+{
+    int m_id = 7;
+    double m_value = 0.25;
+};
+
+std::string typeToString(const sBenchObject& obj)
+{
+    return "sBenchObject { id = " + std::to_string(obj.m_id) + " value = " + std::to_string(obj.m_value) + " }";
+}
+
+struct sBenchPoint
+{
+    int m_id = 7;
+    double m_value = 0.25;
+};
+
+struct sBenchNested
+{
+    sBenchPoint m_first;
+    sBenchPoint m_second;
+};
+
+void writeObject(sLogWriter& out, const sBenchPoint& obj)
+{
+    out << "sBenchPoint { id = " << obj.m_id << " value = " << obj.m_value << " }";
+}
+
+void writeObject(sLogWriter& out, const sBenchNested& obj)
+{
+    out << "sBenchNested { first = " << obj.m_first << " second = " << obj.m_second << " }";
+}
+
+namespace
+{
+    const char* const LogFilePath = "logger_benchmarks.txt";
+
+    enum eSink : int64_t
+    {
+        Cout,
+        File,
+        OpenCloseFile
+    };
+
+    const char* SinkName(int64_t sink)
+    {
+        return sink == Cout ? "cout" : sink == File ? "file" : "openclose";
+    }
+
+    // Swallows the cout output, so the terminal does not take part in the measurement.
+    struct sNullBuffer : std::streambuf
+    {
+        int overflow(int c) override
+        {
+            return c;
+        }
+
+        std::streamsize xsputn(const char*, std::streamsize count) override
+        {
+            return count;
+        }
+    };
+
+    void SetUpSink(const benchmark::State& state, int extraFlags)
+    {
+        if (state.thread_index() != 0)
+            return;
+        const int64_t sink = state.range(0);
+        if (sink == Cout)
+            Logger::adjustSettings(eLogSettings::UseCout | extraFlags);
+        else
+        {
+            Logger::adjustSettings(eLogSettings::UseFile | (sink == OpenCloseFile ? static_cast<int>(eLogSettings::OpenCloseFile) : 0) | extraFlags);
+            Logger::setLogFilePath(LogFilePath, false);
+        }
+    }
+
+    void TearDownSink(const benchmark::State& state)
+    {
+        if (state.thread_index() != 0)
+            return;
+        Logger::flush();
+        Logger::adjustSettings(eLogSettings::UseCout);
+        std::remove(LogFilePath);
+    }
+
+    // Times every call, then reports the percentiles (averaged over the threads) and the
+    // total throughput. Two clock reads per call are included in the latencies.
+    template <typename Func>
+    void MeasureCalls(benchmark::State& state, Func&& func, int extraFlags = 0)
+    {
+        SetUpSink(state, extraFlags);
+        sLatencyHistogram histogram;
+        int64_t i = 0;
+        for (auto _ : state)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func(i++);
+            const auto end = std::chrono::steady_clock::now();
+            histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        }
+        TearDownSink(state);
+
+        state.SetLabel(SinkName(state.range(0)));
+        state.SetItemsProcessed(state.iterations());
+        state.counters["p50_ns"] = benchmark::Counter(static_cast<double>(histogram.percentile(0.5)), benchmark::Counter::kAvgThreads);
+        state.counters["p99_ns"] = benchmark::Counter(static_cast<double>(histogram.percentile(0.99)), benchmark::Counter::kAvgThreads);
+        state.counters["p99.9_ns"] = benchmark::Counter(static_cast<double>(histogram.percentile(0.999)), benchmark::Counter::kAvgThreads);
+    }
+
+    void BM_Print(benchmark::State& state)
+    {
+        MeasureCalls(state, [](int64_t) { Logger::print("Benchmark message", eLogMsgType::Info); });
+    }
+
+    void BM_PrintWithTimestamp(benchmark::State& state)
+    {
+        MeasureCalls(state, [](int64_t) { Logger::print("Benchmark message", eLogMsgType::Info); }, eLogSettings::ShowTimestamp);
+    }
+
+    // BM_Print into the file under a durability policy. Every 100th record is an error, the
+    // records OnError commits.
+    void BM_PrintDurable(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+            Logger::setDurability(static_cast<eLogDurability>(state.range(1)), static_cast<unsigned>(state.range(2)));
+        MeasureCalls(state, [](int64_t i) {
+            Logger::print("Benchmark message", i % 100 == 99 ? eLogMsgType::Error : eLogMsgType::Info);
+        });
+        if (state.thread_index() == 0)
+            Logger::setDurability(eLogDurability::None);
+    }
+
+    // Same as BM_Print with the counters of the logger on.
+    void BM_PrintWithTelemetry(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+            Logger::setTelemetry(true);
+        MeasureCalls(state, [](int64_t) { Logger::print("Benchmark message", eLogMsgType::Info); });
+        if (state.thread_index() == 0)
+            Logger::setTelemetry(false);
+    }
+
+    void BM_PrintFormatted(benchmark::State& state)
+    {
+        MeasureCalls(state, [](int64_t i) {
+            Logger::print(eLogMsgType::Info, LOG_FORMAT("value %lld of %s, ratio %.3f"), static_cast<long long>(i), "benchmark", 0.125);
+        });
+    }
+
+    void BM_PrintObject(benchmark::State& state)
+    {
+        const sBenchObject obj;
+        MeasureCalls(state, [&obj](int64_t) { Logger::printObject(obj); });
+    }
+
+    // Nested objects are streamed into the buffer of the thread without temporary strings.
+    void BM_PrintNestedObject(benchmark::State& state)
+    {
+        const sBenchNested obj;
+        MeasureCalls(state, [&obj](int64_t) { Logger::printObject(obj, eLogMsgType::Info); });
+    }
+
+    void BM_StartStopTimer(benchmark::State& state)
+    {
+        MeasureCalls(state, [](int64_t) {
+            Logger::startTimer("Benchmark timer");
+            Logger::stopTimer(eLogTimerUnits::Nanoseconds, "Benchmark timer");
+        });
+    }
+
+    void BM_MemoryRegion(benchmark::State& state)
+    {
+        MeasureCalls(state, [](int64_t) {
+            Logger::startMemoryRegion("Benchmark region");
+            Logger::stopMemoryRegion();
+        });
+    }
+
+    // An error in a tight loop: nearly every call is rejected by the limiter of the call site.
+    void BM_RateLimitedError(benchmark::State& state)
+    {
+        MeasureCalls(state, [](int64_t) { LOG_RATE_LIMITED(eLogMsgType::Error, 100, 10, "Benchmark error"); });
+    }
+
+    // Production setup without outputs: records only go to the in-memory ring.
+    void BM_PrintToFlightRecorder(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+        {
+            Logger::adjustSettings(0);
+            Logger::setFlightRecorder(1 << 20, "logger_benchmarks_flight.txt", false, false);
+        }
+        int64_t i = 0;
+        for (auto _ : state)
+            Logger::print(eLogMsgType::Info, LOG_FORMAT("value %lld of %s"), static_cast<long long>(i++), "benchmark");
+        if (state.thread_index() == 0)
+        {
+            Logger::setFlightRecorder(0, {});
+            Logger::adjustSettings(eLogSettings::UseCout);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Timer overhead alone: aggregated timers print nothing, the argument selects the clock.
+    void BM_AggregatedTimer(benchmark::State& state)
+    {
+        const auto clock = static_cast<eLogClock>(state.range(0));
+        if (state.thread_index() == 0)
+        {
+            Logger::setClock(clock);
+            Logger::setTimerAggregation(true);
+        }
+        for (auto _ : state)
+        {
+            Logger::startTimer("Benchmark timer");
+            Logger::stopTimer(eLogTimerUnits::Nanoseconds, {});
+        }
+        if (state.thread_index() == 0)
+        {
+            Logger::setTimerAggregation(false);
+            Logger::timerStats(true);
+            Logger::setClock(eLogClock::Steady);
+        }
+        state.SetLabel(clock == eLogClock::Tsc ? "tsc" : "steady");
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Number conversions of the formatting core against the standard functions.
+    enum eFormatMethod : int64_t
+    {
+        Snprintf,
+        ToString,
+        ToChars,
+        Core
+    };
+
+    const char* MethodName(int64_t method)
+    {
+        switch (method)
+        {
+        case Snprintf: return "snprintf";
+        case ToString: return "to_string";
+        case ToChars: return "to_chars";
+        default: return "core";
+        }
+    }
+
+    void BM_FormatInteger(benchmark::State& state)
+    {
+        const int64_t method = state.range(0);
+        std::string out;
+        long long value = 1;
+        for (auto _ : state)
+        {
+            out.clear();
+            value = value * 6364136223846793005LL + 1442695040888963407LL;
+            const long long shown = value >> (value & 63);
+            if (method == Snprintf)
+            {
+                char text[24];
+                out.append(text, static_cast<size_t>(std::snprintf(text, sizeof(text), "%lld", shown)));
+            }
+            else if (method == ToString)
+                out.append(std::to_string(shown));
+            else if (method == ToChars)
+            {
+                char text[24];
+                out.append(text, static_cast<size_t>(std::to_chars(text, text + sizeof(text), shown).ptr - text));
+            }
+            else
+                AppendInteger(out, shown);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetLabel(MethodName(method));
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Shortest round-trip text: snprintf needs %.17g for that, std::to_string prints %f.
+    void BM_FormatDouble(benchmark::State& state)
+    {
+        const int64_t method = state.range(0);
+        std::string out;
+        double value = 0.1;
+        for (auto _ : state)
+        {
+            out.clear();
+            value = value < 1e6 ? value * 1.0001 + 0.37 : 0.1;
+            if (method == Snprintf)
+            {
+                char text[32];
+                out.append(text, static_cast<size_t>(std::snprintf(text, sizeof(text), "%.17g", value)));
+            }
+            else if (method == ToString)
+                out.append(std::to_string(value));
+            else
+                AppendShortest(out, value);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetLabel(MethodName(method));
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // A deferred or binary record: FormatLogArgs against snprintf of the same format.
+    void BM_FormatDeferred(benchmark::State& state)
+    {
+        const int64_t method = state.range(0);
+        const char* const format = "request %d of %s took %lld us, ratio %.3f";
+        std::string captured;
+        std::string out;
+        int i = 0;
+        for (auto _ : state)
+        {
+            out.clear();
+            ++i;
+            if (method == Snprintf)
+            {
+                char text[128];
+                out.append(text, static_cast<size_t>(std::snprintf(text, sizeof(text), format, i, "client", 1234567LL * i, 0.125 * i)));
+            }
+            else
+            {
+                captured.clear();
+                EncodeLogArgs(captured, i, "client", 1234567LL * i, 0.125 * i);
+                FormatLogArgs(format, captured.data(), captured.size(), out);
+            }
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetLabel(MethodName(method));
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    int MaxThreads()
+    {
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    void Configure(benchmark::internal::Benchmark* bench)
+    {
+        bench->ArgName("sink")->DenseRange(Cout, OpenCloseFile)->ThreadRange(1, MaxThreads())->UseRealTime();
+    }
+
+    // The policies with their value: N records or T milliseconds.
+    void ConfigureDurability(benchmark::internal::Benchmark* bench)
+    {
+        const auto policy = [](eLogDurability durability) { return static_cast<int64_t>(durability); };
+        bench->ArgNames({ "sink", "policy", "value" })
+            ->Args({ File, policy(eLogDurability::None), 0 })
+            ->Args({ File, policy(eLogDurability::EveryNRecords), 1 })
+            ->Args({ File, policy(eLogDurability::EveryNRecords), 100 })
+            ->Args({ File, policy(eLogDurability::Interval), 10 })
+            ->Args({ File, policy(eLogDurability::OnError), 0 })
+            ->ThreadRange(1, MaxThreads())->UseRealTime();
+    }
+}
+
+BENCHMARK(BM_Print)->Apply(Configure);
+BENCHMARK(BM_PrintWithTimestamp)->Apply(Configure);
+BENCHMARK(BM_PrintDurable)->Apply(ConfigureDurability);
+BENCHMARK(BM_PrintWithTelemetry)->Apply(Configure);
+BENCHMARK(BM_PrintFormatted)->Apply(Configure);
+BENCHMARK(BM_PrintObject)->Apply(Configure);
+BENCHMARK(BM_PrintNestedObject)->Apply(Configure);
+BENCHMARK(BM_StartStopTimer)->Apply(Configure);
+BENCHMARK(BM_MemoryRegion)->Apply(Configure);
+BENCHMARK(BM_RateLimitedError)->Apply(Configure);
+BENCHMARK(BM_PrintToFlightRecorder)->ThreadRange(1, MaxThreads())->UseRealTime();
+BENCHMARK(BM_AggregatedTimer)->ArgName("clock")->DenseRange(0, 1)->ThreadRange(1, MaxThreads())->UseRealTime();
+BENCHMARK(BM_FormatInteger)->ArgName("method")->DenseRange(Snprintf, Core);
+BENCHMARK(BM_FormatDouble)->ArgName("method")->Arg(Snprintf)->Arg(ToString)->Arg(Core);
+BENCHMARK(BM_FormatDeferred)->ArgName("method")->Arg(Snprintf)->Arg(Core);
+
+int main(int argc, char** argv)
+{
+    // JSON results are written by default, so runs can be compared between releases.
+    std::vector<char*> args(argv, argv + argc);
+    std::string out = "--benchmark_out=LoggerBenchmarks.json";
+    std::string format = "--benchmark_out_format=json";
+    const bool hasOut = std::any_of(args.begin(), args.end(), [](const char* arg) {
+        return std::strncmp(arg, "--benchmark_out=", 16) == 0;
+    });
+    if (!hasOut)
+    {
+        args.push_back(&out[0]);
+        args.push_back(&format[0]);
+    }
+    int count = static_cast<int>(args.size());
+
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+        return 1;
+
+    sNullBuffer nullBuffer;
+    std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+    benchmark::ConsoleReporter console;
+    console.SetOutputStream(&std::cerr);
+    console.SetErrorStream(&std::cerr);
+    benchmark::RunSpecifiedBenchmarks(&console);
+    std::cout.rdbuf(coutBuffer);
+
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Compares the number of allocations and write syscalls per record of the single-buffer
+// record assembly against the previous per-fragment stream inserts.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Logger.h"
+
+namespace
+{
+    std::atomic<unsigned long long> g_allocations{ 0 };
+
+    constexpr int RecordsNum = 20000;
+    const char* const LogFilePath = "record_assembly_bench.txt";
+
+    // Number of write syscalls made by the process so far, -1 if unknown.
+    long long WriteSyscalls()
+    {
+#ifdef __linux__
+        std::FILE* io = std::fopen("/proc/self/io", "r");
+        if (!io)
+            return -1;
+        char key[32];
+        long long value = -1;
+        long long result = -1;
+        while (std::fscanf(io, "%31s %lld", key, &value) == 2)
+        {
+            if (std::string(key) == "syscw:")
+                result = value;
+        }
+        std::fclose(io);
+        return result;
+#else
+        return -1;
+#endif
+    }
+
+    struct sStats
+    {
+        double m_nsPerRecord;
+        double m_allocsPerRecord;
+        double m_syscallsPerRecord;
+    };
+
+    template <typename Func>
+    sStats Measure(Func&& func)
+    {
+        func(0); // warm up thread-local buffers and stream state
+
+        const auto syscallsBefore = WriteSyscalls();
+        const auto allocsBefore = g_allocations.load();
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < RecordsNum; ++i)
+            func(i);
+        const auto end = std::chrono::steady_clock::now();
+        const auto allocs = g_allocations.load() - allocsBefore;
+        const auto syscallsAfter = WriteSyscalls();
+
+        sStats stats;
+        stats.m_nsPerRecord = std::chrono::duration<double, std::nano>(end - start).count() / RecordsNum;
+        stats.m_allocsPerRecord = static_cast<double>(allocs) / RecordsNum;
+        stats.m_syscallsPerRecord = syscallsBefore < 0 ? -1.0
+            : static_cast<double>(syscallsAfter - syscallsBefore) / RecordsNum;
+        return stats;
+    }
+
+    // The assembly used before: the tag, the thread ID and the body are separate
+    // inserts, each of them reaching the file on its own.
+    struct sLegacyFile
+    {
+        bool m_openCloseFileOnWrite;
+        std::ofstream m_file;
+
+        void printToFile(const std::string& value)
+        {
+            if (!m_file.is_open())
+                m_file.open(LogFilePath, std::ios_base::app);
+            m_file << value;
+            if (m_openCloseFileOnWrite)
+                m_file.close();
+        }
+
+        void print(const std::string& msg)
+        {
+            printToFile("[Info]");
+            std::ostringstream ss;
+            ss << std::this_thread::get_id();
+            printToFile("[thread " + ss.str() + "]");
+            printToFile(": " + msg + "\n");
+        }
+    };
+
+    void Report(const char* name, const sStats& legacy, const sStats& current)
+    {
+        std::printf("%-22s %12s %12s %14s\n", name, "ns/record", "allocs/rec", "syscalls/rec");
+        std::printf("  %-20s %12.1f %12.2f %14.2f\n", "per-fragment inserts",
+            legacy.m_nsPerRecord, legacy.m_allocsPerRecord, legacy.m_syscallsPerRecord);
+        std::printf("  %-20s %12.1f %12.2f %14.2f\n", "single buffer",
+            current.m_nsPerRecord, current.m_allocsPerRecord, current.m_syscallsPerRecord);
+    }
+
+    void RunScenario(const char* name, bool openCloseFile)
+    {
+        const std::string msg = "Example of a regular log message with some payload";
+
+        std::remove(LogFilePath);
+        sLegacyFile legacyFile{ openCloseFile, {} };
+        const auto legacy = Measure([&](int) { legacyFile.print(msg); });
+        legacyFile.m_file.close();
+
+        std::remove(LogFilePath);
+        int flags = eLogSettings::UseFile | eLogSettings::ShowThreadID;
+        if (openCloseFile)
+            flags |= eLogSettings::OpenCloseFile;
+        Logger::adjustSettings(flags);
+        Logger::setLogFilePath(LogFilePath, false);
+        const auto current = Measure([&](int) { Logger::print(msg, eLogMsgType::Info); });
+        Logger::flush();
+        Logger::adjustSettings(eLogSettings::UseCout);
+
+        Report(name, legacy, current);
+        std::remove(LogFilePath);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main()
+{
+    RunScenario("file, OpenCloseFile", true);
+    RunScenario("file, buffered", false);
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "ClassExamples.h"
+#include "LogWriter.h"
 
 void A::doSomething()
 {
@@ -8,14 +9,12 @@ void B::performOperation()
 {
 }
 
-std::string typeToString(const A& obj)
+void writeObject(sLogWriter& out, const A& obj)
 {
-	return "type A { m_value = " + std::to_string(obj.m_value)
-		+ " m_precision = " + std::to_string(obj.m_precision) + "}";
+	out << "type A { m_value = " << obj.m_value << " m_precision = " << obj.m_precision << "}";
 }
 
-std::string typeToString(const B& obj)
+void writeObject(sLogWriter& out, const B& obj)
 {
-	return "type B { m_subObj = " + typeToString(obj.m_subObj) +
-		" m_uuid = " + std::to_string(obj.m_uuid) + "}";
+	out << "type B { m_subObj = " << obj.m_subObj << " m_uuid = " << obj.m_uuid << "}";
 }
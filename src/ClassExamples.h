@@ -1,10 +1,10 @@
 #pragma once
 
-#include <string>
+struct sLogWriter;
 
 class A
 {
-	friend std::string typeToString(const A& obj);
+	friend void writeObject(sLogWriter& out, const A& obj);
 public:
 	void doSomething();
 
@@ -15,7 +15,7 @@ private:
 
 class B
 {
-	friend std::string typeToString(const B& obj);
+	friend void writeObject(sLogWriter& out, const B& obj);
 public:
 	void performOperation();
 
@@ -24,5 +24,5 @@ private:
 	long m_uuid = static_cast<long>(434534683);
 };
 
-std::string typeToString(const A& obj);
-std::string typeToString(const B& obj);
+void writeObject(sLogWriter& out, const A& obj);
+void writeObject(sLogWriter& out, const B& obj);
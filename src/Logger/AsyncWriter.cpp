@@ -0,0 +1,122 @@
+#include "AsyncWriter.h"
+#include "Telemetry.h"
+
+#include <chrono>
+
+namespace
+{
+    constexpr size_t MaxBatchSize = 256;
+    constexpr auto IdleWaitTime = std::chrono::milliseconds(50);
+}
+
+sAsyncWriter::sAsyncWriter(size_t capacity, eLogBackpressure policy, WriteFunc write, FlushFunc flush, IdleFunc idle)
+    : m_queue(capacity)
+    , m_policy(policy)
+    , m_write(std::move(write))
+    , m_flush(std::move(flush))
+    , m_idle(std::move(idle))
+{
+    m_thread = std::thread(&sAsyncWriter::run, this);
+}
+
+sAsyncWriter::~sAsyncWriter()
+{
+    m_stop.store(true);
+    wakeWriter();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void sAsyncWriter::push(sLogRecord& record)
+{
+    // Every record is counted before it is queued and retired exactly once,
+    // either by the writer thread or by being dropped.
+    m_pushed.fetch_add(1);
+    while (!m_queue.tryPush(record))
+    {
+        if (m_policy == eLogBackpressure::DropNewest)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            CountTelemetry(eTelemetryCounter::Dropped);
+            m_retired.fetch_add(1);
+            return;
+        }
+
+        if (m_policy == eLogBackpressure::DropOldest)
+        {
+            sLogRecord victim;
+            if (m_queue.tryPop(victim))
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                CountTelemetry(eTelemetryCounter::Dropped);
+                m_retired.fetch_add(1);
+            }
+        }
+        else
+        {
+            wakeWriter();
+            std::this_thread::yield();
+        }
+    }
+
+    if (m_sleeping.load())
+        wakeWriter();
+}
+
+void sAsyncWriter::flush()
+{
+    const auto target = m_pushed.load();
+    wakeWriter();
+
+    std::unique_lock<std::mutex> lock(m_wakeMtx);
+    while (m_retired.load() < target)
+        m_flushCv.wait_for(lock, IdleWaitTime);
+}
+
+unsigned long long sAsyncWriter::dropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void sAsyncWriter::run()
+{
+    sLogRecord record;
+    for (;;)
+    {
+        unsigned long long written = 0;
+        while (written < MaxBatchSize && m_queue.tryPop(record))
+        {
+            m_write(record);
+            ++written;
+        }
+
+        if (written > 0)
+        {
+            m_flush();
+            m_retired.fetch_add(written);
+            {
+                std::lock_guard<std::mutex> lock(m_wakeMtx);
+            }
+            m_flushCv.notify_all();
+        }
+
+        m_idle();
+        if (written > 0)
+            continue;
+        if (m_stop.load())
+            break;
+
+        std::unique_lock<std::mutex> lock(m_wakeMtx);
+        m_sleeping.store(true);
+        m_wakeCv.wait_for(lock, IdleWaitTime, [this]() { return m_stop.load() || !m_queue.empty(); });
+        m_sleeping.store(false);
+    }
+}
+
+void sAsyncWriter::wakeWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMtx);
+    }
+    m_wakeCv.notify_one();
+}
@@ -0,0 +1,79 @@
+/**
+ * @file AsyncWriter.h
+ * @brief Background writer used by the asynchronous logging mode.
+ */
+
+#pragma once
+
+#include "Logger.h"
+#include "LogRecord.h"
+#include "RingBuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Owns the record queue and the thread that drains it into the outputs.
+ * @note The writer callback is only ever called from the background thread.
+ * Destroying the writer drains every queued record before the thread exits.
+ */
+struct sAsyncWriter
+{
+    using WriteFunc = std::function<void(sLogRecord&)>;
+    using FlushFunc = std::function<void()>;
+    using IdleFunc = std::function<void()>;
+
+    /**
+     * @param capacity The queue capacity.
+     * @param policy What to do when the queue is full.
+     * @param write Writes one record to the outputs.
+     * @param flush Flushes the outputs after a batch of records.
+     * @param idle Called whenever the queue is drained and at least every 50 ms.
+     */
+    sAsyncWriter(size_t capacity, eLogBackpressure policy, WriteFunc write, FlushFunc flush, IdleFunc idle);
+    ~sAsyncWriter();
+
+    sAsyncWriter(const sAsyncWriter&) = delete;
+    sAsyncWriter& operator=(const sAsyncWriter&) = delete;
+
+    /**
+     * @brief Queues a record according to the backpressure policy.
+     * @param record The record to queue. It is swapped with a recycled record,
+     * whose content is stale and must be cleared before reuse.
+     */
+    void push(sLogRecord& record);
+
+    /**
+     * @brief Blocks until every record queued before the call is written and the outputs are flushed.
+     */
+    void flush();
+
+    /**
+     * @brief Returns the number of records dropped because the queue was full.
+     */
+    unsigned long long dropped() const;
+
+private:
+    void run();
+    void wakeWriter();
+
+    sRingBuffer<sLogRecord> m_queue;
+    const eLogBackpressure m_policy;
+    WriteFunc m_write;
+    FlushFunc m_flush;
+    IdleFunc m_idle;
+
+    std::atomic<unsigned long long> m_pushed{ 0 };
+    std::atomic<unsigned long long> m_retired{ 0 };
+    std::atomic<unsigned long long> m_dropped{ 0 };
+    std::atomic<bool> m_sleeping{ false };
+    std::atomic<bool> m_stop{ false };
+
+    std::mutex m_wakeMtx;
+    std::condition_variable m_wakeCv;
+    std::condition_variable m_flushCv;
+    std::thread m_thread;
+};
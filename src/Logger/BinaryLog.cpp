@@ -0,0 +1,473 @@
+#include "BinaryLog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+#define BINARY_LOG_MAGIC "SLOG"
+#define BINARY_LOG_VERSION 1
+#define THREAD_TAG_FLAG 0x08
+#define LEVEL_MASK 0x07
+#define MAX_TABLE_SIZE (1 << 24)
+
+    char Tag(eBinaryLogFrame kind, uint8_t low = 0)
+    {
+        return static_cast<char>((static_cast<uint8_t>(kind) << 4) | low);
+    }
+
+    void AppendVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void AppendZigZag(std::string& out, int64_t value)
+    {
+        AppendVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void AppendBytes(std::string& out, const char* data, size_t size)
+    {
+        AppendVarint(out, size);
+        out.append(data, size);
+    }
+
+    void AppendDouble(std::string& out, double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+    }
+
+    bool ReadVarint(const char*& pos, const char* end, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; pos < end && shift < 64; shift += 7)
+        {
+            const auto byte = static_cast<uint8_t>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool ReadZigZag(const char*& pos, const char* end, int64_t& value)
+    {
+        uint64_t raw;
+        if (!ReadVarint(pos, end, raw))
+            return false;
+        value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+        return true;
+    }
+
+    bool ReadBytes(const char*& pos, const char* end, const char*& data, size_t& size)
+    {
+        uint64_t length;
+        if (!ReadVarint(pos, end, length) || length > static_cast<uint64_t>(end - pos))
+            return false;
+        data = pos;
+        size = static_cast<size_t>(length);
+        pos += size;
+        return true;
+    }
+
+    bool ReadDouble(const char*& pos, const char* end, double& value)
+    {
+        if (end - pos < 8)
+            return false;
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits |= static_cast<uint64_t>(static_cast<uint8_t>(pos[i])) << (8 * i);
+        std::memcpy(&value, &bits, sizeof(value));
+        pos += 8;
+        return true;
+    }
+
+    template <typename T>
+    T ReadRaw(const char*& pos)
+    {
+        T value;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    // Rewrites arguments captured by EncodeLogArgs with varints instead of fixed-size values.
+    // long double is stored as double, so files do not depend on its size.
+    void CompactArgs(const std::string& args, std::string& out)
+    {
+        const char* pos = args.data();
+        const char* end = pos + args.size();
+        while (pos < end)
+        {
+            const auto type = static_cast<eLogArgType>(*pos++);
+            out.push_back(static_cast<char>(type));
+            switch (type)
+            {
+            case eLogArgType::Int: AppendZigZag(out, ReadRaw<int>(pos)); break;
+            case eLogArgType::UInt: AppendVarint(out, ReadRaw<unsigned int>(pos)); break;
+            case eLogArgType::Long: AppendZigZag(out, ReadRaw<long>(pos)); break;
+            case eLogArgType::ULong: AppendVarint(out, ReadRaw<unsigned long>(pos)); break;
+            case eLogArgType::LongLong: AppendZigZag(out, ReadRaw<long long>(pos)); break;
+            case eLogArgType::ULongLong: AppendVarint(out, ReadRaw<unsigned long long>(pos)); break;
+            case eLogArgType::Double: AppendDouble(out, ReadRaw<double>(pos)); break;
+            case eLogArgType::LongDouble: AppendDouble(out, static_cast<double>(ReadRaw<long double>(pos))); break;
+            case eLogArgType::Pointer: AppendVarint(out, reinterpret_cast<uintptr_t>(ReadRaw<const void*>(pos))); break;
+            case eLogArgType::String:
+            {
+                const auto size = ReadRaw<uint32_t>(pos);
+                AppendBytes(out, pos, size);
+                pos += size + 1;
+                break;
+            }
+            }
+        }
+    }
+
+    // The inverse of CompactArgs.
+    bool ExpandArgs(const char* pos, const char* end, std::string& out)
+    {
+        using LogArgsDetail::AppendRaw;
+        while (pos < end)
+        {
+            const auto type = static_cast<eLogArgType>(*pos++);
+            uint64_t value = 0;
+            int64_t signedValue = 0;
+            double doubleValue = 0;
+            switch (type)
+            {
+            case eLogArgType::Int:
+                if (!ReadZigZag(pos, end, signedValue))
+                    return false;
+                AppendRaw(out, type, static_cast<int>(signedValue));
+                break;
+            case eLogArgType::UInt:
+                if (!ReadVarint(pos, end, value))
+                    return false;
+                AppendRaw(out, type, static_cast<unsigned int>(value));
+                break;
+            case eLogArgType::Long:
+                if (!ReadZigZag(pos, end, signedValue))
+                    return false;
+                AppendRaw(out, type, static_cast<long>(signedValue));
+                break;
+            case eLogArgType::ULong:
+                if (!ReadVarint(pos, end, value))
+                    return false;
+                AppendRaw(out, type, static_cast<unsigned long>(value));
+                break;
+            case eLogArgType::LongLong:
+                if (!ReadZigZag(pos, end, signedValue))
+                    return false;
+                AppendRaw(out, type, static_cast<long long>(signedValue));
+                break;
+            case eLogArgType::ULongLong:
+                if (!ReadVarint(pos, end, value))
+                    return false;
+                AppendRaw(out, type, static_cast<unsigned long long>(value));
+                break;
+            case eLogArgType::Double:
+                if (!ReadDouble(pos, end, doubleValue))
+                    return false;
+                AppendRaw(out, type, doubleValue);
+                break;
+            case eLogArgType::LongDouble:
+                if (!ReadDouble(pos, end, doubleValue))
+                    return false;
+                AppendRaw(out, type, static_cast<long double>(doubleValue));
+                break;
+            case eLogArgType::Pointer:
+                if (!ReadVarint(pos, end, value))
+                    return false;
+                AppendRaw(out, type, reinterpret_cast<const void*>(static_cast<uintptr_t>(value)));
+                break;
+            case eLogArgType::String:
+            {
+                const char* data;
+                size_t size;
+                if (!ReadBytes(pos, end, data, size))
+                    return false;
+                LogArgsDetail::AppendString(out, data, size);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+sBinaryLogEncoder::sBinaryLogEncoder(ThreadNameFunc threadName)
+    : m_threadName(threadName)
+{
+}
+
+void sBinaryLogEncoder::reset()
+{
+    m_hasHeader = false;
+    m_formats.clear();
+    m_copiedFormats.clear();
+    m_formatsCount = 0;
+    m_knownThreads.clear();
+}
+
+void sBinaryLogEncoder::encode(const sLogRecord& record, std::string& out)
+{
+    if (!m_hasHeader)
+    {
+        out.push_back(Tag(eBinaryLogFrame::Header));
+        out.append(BINARY_LOG_MAGIC);
+        out.push_back(static_cast<char>(BINARY_LOG_VERSION));
+        AppendVarint(out, static_cast<uint64_t>(record.m_time));
+        m_lastTime = record.m_time;
+        m_hasHeader = true;
+    }
+    if (record.m_threadIndex >= m_knownThreads.size() || !m_knownThreads[record.m_threadIndex])
+        defineThread(record.m_threadIndex, out);
+
+    const bool hasArgs = record.hasFormat();
+    const uint32_t id = hasArgs ? formatId(record, out) : 0;
+    const auto low = static_cast<uint8_t>((record.m_hasThreadTag ? THREAD_TAG_FLAG : 0) | static_cast<uint8_t>(record.m_type));
+    out.push_back(Tag(hasArgs ? eBinaryLogFrame::Args : eBinaryLogFrame::Text, low));
+    AppendZigZag(out, record.m_time - m_lastTime);
+    m_lastTime = record.m_time;
+    AppendVarint(out, record.m_threadIndex);
+
+    if (hasArgs)
+    {
+        AppendVarint(out, id);
+        // The size goes in front of the arguments, so they are compacted after a placeholder
+        // of the size a varint takes for short arguments and moved if that was not enough.
+        const size_t sizePos = out.size();
+        out.push_back('\0');
+        CompactArgs(record.m_args, out);
+        const size_t size = out.size() - sizePos - 1;
+        if (size < 0x80)
+            out[sizePos] = static_cast<char>(size);
+        else
+        {
+            std::string sizeBytes;
+            AppendVarint(sizeBytes, size);
+            out.replace(sizePos, 1, sizeBytes);
+        }
+        return;
+    }
+
+    size_t size = record.m_plain.size() - std::min(record.m_messageOffset, record.m_plain.size());
+    if (size > 0 && record.m_plain.back() == '\n')
+        --size;
+    AppendBytes(out, record.m_plain.data() + record.m_messageOffset, size);
+}
+
+uint32_t sBinaryLogEncoder::formatId(const sLogRecord& record, std::string& out)
+{
+    // A copied format has no lasting address, it is keyed by its text.
+    if (record.m_hasOwnFormat)
+    {
+        const auto it = m_copiedFormats.find(record.m_ownFormat);
+        if (it != m_copiedFormats.end())
+            return it->second;
+        const uint32_t id = defineFormat(record.m_ownFormat, out);
+        m_copiedFormats.emplace(record.m_ownFormat, id);
+        return id;
+    }
+
+    // Formats are keyed by address, the text is compared in case a buffer was reused.
+    const char* format = record.m_format;
+    auto it = m_formats.find(format);
+    if (it != m_formats.end() && it->second.m_text == format)
+        return it->second.m_id;
+
+    sFormat& entry = m_formats[format];
+    entry.m_text = format;
+    entry.m_id = defineFormat(entry.m_text, out);
+    return entry.m_id;
+}
+
+uint32_t sBinaryLogEncoder::defineFormat(const std::string& text, std::string& out)
+{
+    const uint32_t id = m_formatsCount++;
+    out.push_back(Tag(eBinaryLogFrame::Format));
+    AppendVarint(out, id);
+    AppendBytes(out, text.data(), text.size());
+    return id;
+}
+
+void sBinaryLogEncoder::defineThread(uint32_t index, std::string& out)
+{
+    if (index >= m_knownThreads.size())
+        m_knownThreads.resize(index + 1, false);
+    m_knownThreads[index] = true;
+
+    const std::string name = m_threadName(index);
+    out.push_back(Tag(eBinaryLogFrame::Thread));
+    AppendVarint(out, index);
+    AppendBytes(out, name.data(), name.size());
+}
+
+sBinaryLogReader::sBinaryLogReader(const char* data, size_t size, bool isComplete)
+    : m_pos(data)
+    , m_end(data + size)
+    , m_isComplete(isComplete)
+{
+}
+
+void sBinaryLogReader::refill(const char* data, size_t size, bool isComplete)
+{
+    m_pos = data;
+    m_end = data + size;
+    m_isComplete = isComplete;
+}
+
+bool sBinaryLogReader::next(sBinaryLogRecord& record)
+{
+    while (m_pos < m_end && !m_isCorrupt)
+    {
+        const char* frame = m_pos;
+        const int64_t lastTime = m_lastTime;
+        const auto tag = static_cast<uint8_t>(*m_pos++);
+        const auto kind = static_cast<eBinaryLogFrame>(tag >> 4);
+        bool isValid = false;
+        switch (kind)
+        {
+        case eBinaryLogFrame::Header: isValid = readHeader(); break;
+        case eBinaryLogFrame::Format: isValid = readDefinition(m_formats); break;
+        case eBinaryLogFrame::Thread: isValid = readDefinition(m_threads); break;
+        case eBinaryLogFrame::Text:
+        case eBinaryLogFrame::Args:
+            if (readRecord(kind, tag, record))
+                return true;
+            break;
+        }
+        // Until the log is complete, a frame that does not read may only be cut off.
+        if (!isValid && !m_isComplete)
+        {
+            m_pos = frame;
+            m_lastTime = lastTime;
+            return false;
+        }
+        m_isCorrupt = !isValid;
+    }
+    return false;
+}
+
+bool sBinaryLogReader::readHeader()
+{
+    const size_t magicSize = std::strlen(BINARY_LOG_MAGIC);
+    if (static_cast<size_t>(m_end - m_pos) < magicSize + 1 || std::memcmp(m_pos, BINARY_LOG_MAGIC, magicSize) != 0)
+        return false;
+    m_pos += magicSize;
+    if (*m_pos++ != BINARY_LOG_VERSION)
+        return false;
+
+    uint64_t startTime;
+    if (!ReadVarint(m_pos, m_end, startTime))
+        return false;
+    m_lastTime = static_cast<int64_t>(startTime);
+    m_formats.clear();
+    m_threads.clear();
+    return true;
+}
+
+bool sBinaryLogReader::readDefinition(std::vector<std::string>& table)
+{
+    uint64_t index;
+    const char* data;
+    size_t size;
+    if (!ReadVarint(m_pos, m_end, index) || index >= MAX_TABLE_SIZE || !ReadBytes(m_pos, m_end, data, size))
+        return false;
+    if (index >= table.size())
+        table.resize(static_cast<size_t>(index) + 1);
+    table[static_cast<size_t>(index)].assign(data, size);
+    return true;
+}
+
+bool sBinaryLogReader::readRecord(eBinaryLogFrame kind, uint8_t tag, sBinaryLogRecord& record)
+{
+    int64_t delta;
+    uint64_t threadIndex;
+    if (!ReadZigZag(m_pos, m_end, delta) || !ReadVarint(m_pos, m_end, threadIndex))
+        return false;
+    m_lastTime += delta;
+
+    const uint8_t level = tag & LEVEL_MASK;
+    if (level > static_cast<uint8_t>(eLogMsgType::Error))
+        return false;
+    record.m_type = static_cast<eLogMsgType>(level);
+    record.m_hasThreadTag = (tag & THREAD_TAG_FLAG) != 0;
+    record.m_time = m_lastTime;
+    if (threadIndex < m_threads.size())
+        record.m_thread = m_threads[static_cast<size_t>(threadIndex)];
+    else
+        record.m_thread = std::to_string(threadIndex);
+    record.m_message.clear();
+
+    if (kind == eBinaryLogFrame::Text)
+    {
+        const char* data;
+        size_t size;
+        if (!ReadBytes(m_pos, m_end, data, size))
+            return false;
+        record.m_message.assign(data, size);
+        return true;
+    }
+
+    uint64_t formatId;
+    const char* data;
+    size_t size;
+    if (!ReadVarint(m_pos, m_end, formatId) || formatId >= m_formats.size() || !ReadBytes(m_pos, m_end, data, size))
+        return false;
+    m_args.clear();
+    if (!ExpandArgs(data, data + size, m_args))
+        return false;
+    FormatLogArgs(m_formats[static_cast<size_t>(formatId)].c_str(), m_args.data(), m_args.size(), record.m_message);
+    return true;
+}
+
+void AppendTextRecord(const sBinaryLogRecord& record, std::string& out)
+{
+    static const char* const tags[] = { "", "[Trace]", "[Debug]", "[Info]", "[Warning]", "[ERROR]" };
+    out.append(tags[static_cast<size_t>(record.m_type)]);
+    if (record.m_hasThreadTag)
+    {
+        out.append("[thread ");
+        out.append(record.m_thread);
+        out.push_back(']');
+    }
+    if (record.m_type != eLogMsgType::None || record.m_hasThreadTag)
+        out.append(": ");
+    out.append(record.m_message);
+    out.push_back('\n');
+}
+
+void AppendRecordTime(int64_t microseconds, std::string& out)
+{
+    int64_t second = microseconds / 1000000;
+    int64_t fraction = microseconds % 1000000;
+    if (fraction < 0)
+    {
+        fraction += 1000000;
+        --second;
+    }
+    const std::time_t seconds = static_cast<std::time_t>(second);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char text[48];
+    const size_t size = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(text + size, sizeof(text) - size, ".%06lld ", static_cast<long long>(fraction));
+    out.append(text);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file BinaryLog.h
+ * @brief Compact binary log file format, written by the logger and read by logdecode.
+ *
+ * A binary log is a sequence of frames. Every frame starts with a tag byte that holds the
+ * frame kind in the high nibble and, for records, the level and the thread tag flag in the
+ * low nibble. Numbers are LEB128 varints, signed ones zigzag encoded:
+ *   Header: tag, "SLOG", version, start time (microseconds since the Unix epoch)
+ *   Format: tag, id, size, format string
+ *   Thread: tag, index, size, thread name
+ *   Text:   tag, time delta, thread index, size, message
+ *   Args:   tag, time delta, thread index, format id, size, arguments
+ * Format strings and thread names are stored once per file, before the first record that
+ * uses them. Every time the file is opened a header starts a new session, so a file written
+ * by several runs of a program stays readable.
+ */
+
+#pragma once
+
+#include "LogRecord.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Kind of a binary log frame.
+ */
+enum class eBinaryLogFrame : uint8_t
+{
+    Header = 0,
+    Format = 1,
+    Thread = 2,
+    Text = 3,
+    Args = 4
+};
+
+/**
+ * @brief Turns records into binary log frames.
+ */
+struct sBinaryLogEncoder
+{
+    using ThreadNameFunc = std::string (*)(uint32_t index);
+
+    /**
+     * @param threadName Returns the name of the thread with the given index.
+     */
+    explicit sBinaryLogEncoder(ThreadNameFunc threadName);
+
+    /**
+     * @brief Forgets the stored formats and threads, the next record starts a new session.
+     */
+    void reset();
+
+    /**
+     * @brief Appends the frames of the record to out.
+     */
+    void encode(const sLogRecord& record, std::string& out);
+
+private:
+    uint32_t formatId(const sLogRecord& record, std::string& out);
+    uint32_t defineFormat(const std::string& text, std::string& out);
+    void defineThread(uint32_t index, std::string& out);
+
+    struct sFormat
+    {
+        uint32_t m_id;
+        std::string m_text;
+    };
+
+    ThreadNameFunc m_threadName;
+    bool m_hasHeader = false;
+    int64_t m_lastTime = 0;
+    std::unordered_map<const char*, sFormat> m_formats;
+    std::unordered_map<std::string, uint32_t> m_copiedFormats;
+    uint32_t m_formatsCount = 0;
+    std::vector<bool> m_knownThreads;
+};
+
+/**
+ * @brief A record read back from a binary log.
+ */
+struct sBinaryLogRecord
+{
+    eLogMsgType m_type = eLogMsgType::None;
+    bool m_hasThreadTag = false;
+    int64_t m_time = 0;       //!< Microseconds since the Unix epoch
+    std::string m_thread;
+    std::string m_message;    //!< Message without the line break
+};
+
+/**
+ * @brief Reads the records of a binary log held in memory, whole or in pieces.
+ */
+struct sBinaryLogReader
+{
+    /**
+     * @param isComplete false if more of the log follows, see refill().
+     */
+    sBinaryLogReader(const char* data, size_t size, bool isComplete = true);
+
+    /**
+     * @brief Continues with the next piece of the log. The piece starts with the unread bytes
+     * of the previous one, see unreadSize().
+     * @param isComplete false if more of the log follows.
+     */
+    void refill(const char* data, size_t size, bool isComplete);
+
+    /**
+     * @brief Returns the number of bytes after the last frame read. Before the log is complete,
+     * a frame cut off at the end of the piece is left unread.
+     */
+    size_t unreadSize() const
+    {
+        return static_cast<size_t>(m_end - m_pos);
+    }
+
+    /**
+     * @brief Reads the next record.
+     * @return false at the end of the data or at a damaged frame, see isCorrupt().
+     */
+    bool next(sBinaryLogRecord& record);
+
+    /**
+     * @brief Returns true if reading stopped at a damaged frame.
+     */
+    bool isCorrupt() const
+    {
+        return m_isCorrupt;
+    }
+
+private:
+    bool readHeader();
+    bool readDefinition(std::vector<std::string>& table);
+    bool readRecord(eBinaryLogFrame kind, uint8_t tag, sBinaryLogRecord& record);
+
+    const char* m_pos;
+    const char* m_end;
+    bool m_isComplete;
+    bool m_isCorrupt = false;
+    int64_t m_lastTime = 0;
+    std::vector<std::string> m_formats;
+    std::vector<std::string> m_threads;
+    std::string m_args;
+};
+
+/**
+ * @brief Appends the record in the text layout of the logger, including the line break.
+ */
+void AppendTextRecord(const sBinaryLogRecord& record, std::string& out);
+
+/**
+ * @brief Appends the time of a record in the layout of eLogSettings::ShowTimestamp,
+ * "YYYY-MM-DD HH:MM:SS.uuuuuu " in local time.
+ */
+void AppendRecordTime(int64_t microseconds, std::string& out);
@@ -0,0 +1,278 @@
+#include "Compression.h"
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+#define XXH_PRIME32_1 2654435761U
+#define XXH_PRIME32_2 2246822519U
+#define XXH_PRIME32_3 3266489917U
+#define XXH_PRIME32_4 668265263U
+#define XXH_PRIME32_5 374761393U
+
+#define LZ4_FRAME_MAGIC 0x184D2204U
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5     // The last bytes of a block are always literals
+#define LZ4_MATCH_FIND_LIMIT 12 // The last match starts at least this far from the end
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+#define LZ4_UNCOMPRESSED_BLOCK 0x80000000U
+
+    uint32_t RotateLeft(uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    uint32_t ReadLE32(const uint8_t* pos)
+    {
+        return static_cast<uint32_t>(pos[0]) | (static_cast<uint32_t>(pos[1]) << 8)
+            | (static_cast<uint32_t>(pos[2]) << 16) | (static_cast<uint32_t>(pos[3]) << 24);
+    }
+
+    void WriteLE32(char* pos, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            pos[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+    void AppendLE32(std::string& out, uint32_t value)
+    {
+        char bytes[4];
+        WriteLE32(bytes, value);
+        out.append(bytes, sizeof(bytes));
+    }
+
+    uint32_t XxRound(uint32_t acc, uint32_t input)
+    {
+        acc += input * XXH_PRIME32_2;
+        return RotateLeft(acc, 13) * XXH_PRIME32_1;
+    }
+
+    uint32_t HashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+    }
+
+    uint8_t* AppendLength(uint8_t* op, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            *op++ = 255;
+        *op++ = static_cast<uint8_t>(length);
+        return op;
+    }
+
+    uint8_t* AppendSequence(uint8_t* op, const uint8_t* literals, size_t literalsSize,
+        size_t offset, size_t matchSize)
+    {
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>((literalsSize >= 15 ? 15 : literalsSize) << 4);
+        if (literalsSize >= 15)
+            op = AppendLength(op, literalsSize - 15);
+        std::memcpy(op, literals, literalsSize);
+        op += literalsSize;
+
+        // The last sequence of a block has literals only.
+        if (matchSize == 0)
+            return op;
+
+        *op++ = static_cast<uint8_t>(offset & 0xFF);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        const size_t matchCode = matchSize - LZ4_MIN_MATCH;
+        *token |= static_cast<uint8_t>(matchCode >= 15 ? 15 : matchCode);
+        if (matchCode >= 15)
+            op = AppendLength(op, matchCode - 15);
+        return op;
+    }
+
+    // Compresses one independent block into dst, which must hold CompressBound(size) bytes.
+    size_t CompressBlock(const uint8_t* src, size_t size, uint8_t* dst)
+    {
+        const uint8_t* const end = src + size;
+        const uint8_t* anchor = src;
+        uint8_t* op = dst;
+
+        if (size > LZ4_MATCH_FIND_LIMIT)
+        {
+            const uint8_t* const matchFindLimit = end - LZ4_MATCH_FIND_LIMIT;
+            const uint8_t* const matchEndLimit = end - LZ4_LAST_LITERALS;
+            std::unique_ptr<uint32_t[]> table(new uint32_t[1 << LZ4_HASH_BITS]());
+
+            const uint8_t* ip = src + 1;
+            while (ip < matchFindLimit)
+            {
+                const uint32_t sequence = ReadLE32(ip);
+                const uint32_t hash = HashSequence(sequence);
+                const uint8_t* ref = src + table[hash];
+                table[hash] = static_cast<uint32_t>(ip - src);
+
+                if (ref >= ip || static_cast<size_t>(ip - ref) > LZ4_MAX_OFFSET || ReadLE32(ref) != sequence)
+                {
+                    ++ip;
+                    continue;
+                }
+
+                while (ip > anchor && ref > src && ip[-1] == ref[-1])
+                {
+                    --ip;
+                    --ref;
+                }
+                const uint8_t* matchEnd = ip + LZ4_MIN_MATCH;
+                const uint8_t* refEnd = ref + LZ4_MIN_MATCH;
+                while (matchEnd < matchEndLimit && *matchEnd == *refEnd)
+                {
+                    ++matchEnd;
+                    ++refEnd;
+                }
+
+                op = AppendSequence(op, anchor, static_cast<size_t>(ip - anchor),
+                    static_cast<size_t>(ip - ref), static_cast<size_t>(matchEnd - ip));
+                ip = matchEnd;
+                anchor = ip;
+                if (ip - 2 > src)
+                    table[HashSequence(ReadLE32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+            }
+        }
+
+        op = AppendSequence(op, anchor, static_cast<size_t>(end - anchor), 0, 0);
+        return static_cast<size_t>(op - dst);
+    }
+
+    size_t CompressBound(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+}
+
+sXxHash32::sXxHash32(uint32_t seed)
+    : m_seed(seed)
+{
+    m_acc[0] = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+    m_acc[1] = seed + XXH_PRIME32_2;
+    m_acc[2] = seed;
+    m_acc[3] = seed - XXH_PRIME32_1;
+}
+
+void sXxHash32::consume(const uint8_t* block)
+{
+    for (int i = 0; i < 4; ++i)
+        m_acc[i] = XxRound(m_acc[i], ReadLE32(block + 4 * i));
+}
+
+void sXxHash32::update(const void* data, size_t size)
+{
+    auto pos = static_cast<const uint8_t*>(data);
+    m_total += size;
+
+    if (m_tailSize + size < sizeof(m_tail))
+    {
+        std::memcpy(m_tail + m_tailSize, pos, size);
+        m_tailSize += size;
+        return;
+    }
+    if (m_tailSize > 0)
+    {
+        const size_t fill = sizeof(m_tail) - m_tailSize;
+        std::memcpy(m_tail + m_tailSize, pos, fill);
+        consume(m_tail);
+        pos += fill;
+        size -= fill;
+        m_tailSize = 0;
+    }
+    for (; size >= sizeof(m_tail); pos += sizeof(m_tail), size -= sizeof(m_tail))
+        consume(pos);
+    std::memcpy(m_tail, pos, size);
+    m_tailSize = size;
+}
+
+uint32_t sXxHash32::digest() const
+{
+    uint32_t hash = m_total >= sizeof(m_tail)
+        ? RotateLeft(m_acc[0], 1) + RotateLeft(m_acc[1], 7) + RotateLeft(m_acc[2], 12) + RotateLeft(m_acc[3], 18)
+        : m_seed + XXH_PRIME32_5;
+    hash += static_cast<uint32_t>(m_total);
+
+    size_t pos = 0;
+    for (; pos + 4 <= m_tailSize; pos += 4)
+        hash = RotateLeft(hash + ReadLE32(m_tail + pos) * XXH_PRIME32_3, 17) * XXH_PRIME32_4;
+    for (; pos < m_tailSize; ++pos)
+        hash = RotateLeft(hash + m_tail[pos] * XXH_PRIME32_5, 11) * XXH_PRIME32_1;
+
+    hash ^= hash >> 15;
+    hash *= XXH_PRIME32_2;
+    hash ^= hash >> 13;
+    hash *= XXH_PRIME32_3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+void sLz4FrameWriter::begin(std::string& out)
+{
+    // Version 01, independent blocks, content checksum; 64KB maximum block size.
+    const uint8_t descriptor[2] = { 0x64, 0x40 };
+    sXxHash32 headerHash;
+    headerHash.update(descriptor, sizeof(descriptor));
+
+    AppendLE32(out, LZ4_FRAME_MAGIC);
+    out.append(reinterpret_cast<const char*>(descriptor), sizeof(descriptor));
+    out.push_back(static_cast<char>((headerHash.digest() >> 8) & 0xFF));
+    m_contentHash = sXxHash32();
+}
+
+void sLz4FrameWriter::compressBlock(const char* data, size_t size, std::string& out)
+{
+    if (size == 0)
+        return;
+    m_contentHash.update(data, size);
+
+    const size_t headerPos = out.size();
+    out.resize(headerPos + 4 + CompressBound(size));
+    auto dst = reinterpret_cast<uint8_t*>(&out[headerPos + 4]);
+    const size_t compressed = CompressBlock(reinterpret_cast<const uint8_t*>(data), size, dst);
+
+    if (compressed < size)
+    {
+        out.resize(headerPos + 4 + compressed);
+        WriteLE32(&out[headerPos], static_cast<uint32_t>(compressed));
+    }
+    else
+    {
+        // Data that does not compress is stored as is.
+        out.resize(headerPos);
+        AppendLE32(out, static_cast<uint32_t>(size) | LZ4_UNCOMPRESSED_BLOCK);
+        out.append(data, size);
+    }
+}
+
+void sLz4FrameWriter::end(std::string& out)
+{
+    AppendLE32(out, 0);
+    AppendLE32(out, m_contentHash.digest());
+}
+
+bool CompressFileLz4(const std::string& source, const std::string& destination)
+{
+    std::ifstream input(source, std::ios::binary);
+    std::ofstream output(destination, std::ios::binary | std::ios::trunc);
+    if (!input.is_open() || !output.is_open())
+        return false;
+
+    sLz4FrameWriter writer;
+    std::string block(sLz4FrameWriter::BLOCK_SIZE, '\0');
+    std::string frame;
+    writer.begin(frame);
+    for (;;)
+    {
+        input.read(&block[0], static_cast<std::streamsize>(block.size()));
+        const auto count = static_cast<size_t>(input.gcount());
+        if (count == 0)
+            break;
+        writer.compressBlock(block.data(), count, frame);
+        output.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        frame.clear();
+    }
+    writer.end(frame);
+    output.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+    return !input.bad() && output.good();
+}
@@ -0,0 +1,68 @@
+/**
+ * @file Compression.h
+ * @brief Built-in LZ4 frame compressor for rotated log files.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Incremental xxHash32, the checksum used by the LZ4 frame format.
+ */
+struct sXxHash32
+{
+    explicit sXxHash32(uint32_t seed = 0);
+
+    void update(const void* data, size_t size);
+    uint32_t digest() const;
+
+private:
+    void consume(const uint8_t* block);
+
+    uint32_t m_seed;
+    uint32_t m_acc[4];
+    uint64_t m_total = 0;
+    uint8_t m_tail[16];
+    size_t m_tailSize = 0;
+};
+
+/**
+ * @brief Writes the LZ4 frame format block by block.
+ * @note The output can be read by the lz4 command line tool and by any LZ4 frame decoder.
+ * Blocks are compressed independently with a greedy single-pass matcher, which favours
+ * speed over ratio. Log text still compresses several times.
+ */
+struct sLz4FrameWriter
+{
+    /**
+     * @brief Maximum number of bytes passed to a single compressBlock call.
+     */
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * @brief Appends the frame header to out.
+     */
+    void begin(std::string& out);
+
+    /**
+     * @brief Compresses up to BLOCK_SIZE bytes and appends the block to out.
+     */
+    void compressBlock(const char* data, size_t size, std::string& out);
+
+    /**
+     * @brief Appends the end mark and the content checksum to out.
+     */
+    void end(std::string& out);
+
+private:
+    sXxHash32 m_contentHash;
+};
+
+/**
+ * @brief Compresses a file into the LZ4 frame format.
+ * @return false if the source could not be read or the destination could not be written.
+ */
+bool CompressFileLz4(const std::string& source, const std::string& destination);
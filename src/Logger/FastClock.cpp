@@ -0,0 +1,159 @@
+#include "FastClock.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define LOGGER_HAS_TSC 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+        #include <x86intrin.h>
+    #endif
+#else
+    #define LOGGER_HAS_TSC 0
+#endif
+
+namespace
+{
+#define TSC_CALIBRATION_TIME_MS 10
+#define TSC_RECALIBRATION_PERIOD_NS 1000000000.0
+
+    struct sTscState
+    {
+        std::atomic<bool> m_isUsed{ false };
+        std::atomic<double> m_nsPerTick{ 0.0 };
+        std::atomic<uint64_t> m_nextCalibration{ 0 };   //!< TSC reading of the next refinement
+        // Reference readings, written only while the TSC is not in use.
+        uint64_t m_baseTicks = 0;
+        uint64_t m_baseSteadyNs = 0;
+        int64_t m_baseSystemUs = 0;
+        std::mutex m_mtx;
+    };
+
+    sTscState g_tsc;
+
+    uint64_t SteadyNanoseconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    int64_t SystemMicroseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t ReadTsc()
+    {
+#if LOGGER_HAS_TSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    bool HasInvariantTsc()
+    {
+#if LOGGER_HAS_TSC
+    #ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0x80000000);
+        if (static_cast<unsigned>(info[0]) < 0x80000007)
+            return false;
+        __cpuid(info, 0x80000007);
+        return (info[3] >> 8) & 1;
+    #else
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+            return false;
+        return (edx >> 8) & 1;
+    #endif
+#else
+        return false;
+#endif
+    }
+
+    // Refines the rate over the whole time since the reference readings.
+    void Recalibrate(uint64_t ticks)
+    {
+        uint64_t next = g_tsc.m_nextCalibration.load(std::memory_order_relaxed);
+        if (ticks < next)
+            return;
+
+        const double nsPerTick = g_tsc.m_nsPerTick.load(std::memory_order_relaxed);
+        const auto period = static_cast<uint64_t>(TSC_RECALIBRATION_PERIOD_NS / nsPerTick);
+        if (!g_tsc.m_nextCalibration.compare_exchange_strong(next, ticks + period, std::memory_order_relaxed))
+            return;
+
+        const uint64_t steadyNs = SteadyNanoseconds();
+        const uint64_t now = ReadTsc();
+        if (now > g_tsc.m_baseTicks && steadyNs > g_tsc.m_baseSteadyNs)
+        {
+            g_tsc.m_nsPerTick.store(static_cast<double>(steadyNs - g_tsc.m_baseSteadyNs)
+                / static_cast<double>(now - g_tsc.m_baseTicks), std::memory_order_relaxed);
+        }
+    }
+}
+
+bool SetTscClock(bool isEnabled)
+{
+    std::lock_guard<std::mutex> lock(g_tsc.m_mtx);
+    if (!isEnabled || !HasInvariantTsc())
+    {
+        g_tsc.m_isUsed.store(false, std::memory_order_release);
+        return false;
+    }
+    if (g_tsc.m_isUsed.load(std::memory_order_relaxed))
+        return true;
+
+    g_tsc.m_baseSystemUs = SystemMicroseconds();
+    g_tsc.m_baseSteadyNs = SteadyNanoseconds();
+    g_tsc.m_baseTicks = ReadTsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(TSC_CALIBRATION_TIME_MS));
+    const uint64_t steadyNs = SteadyNanoseconds();
+    const uint64_t ticks = ReadTsc();
+    if (ticks <= g_tsc.m_baseTicks || steadyNs <= g_tsc.m_baseSteadyNs)
+        return false;
+
+    const double nsPerTick = static_cast<double>(steadyNs - g_tsc.m_baseSteadyNs) / static_cast<double>(ticks - g_tsc.m_baseTicks);
+    g_tsc.m_nsPerTick.store(nsPerTick, std::memory_order_relaxed);
+    g_tsc.m_nextCalibration.store(ticks + static_cast<uint64_t>(TSC_RECALIBRATION_PERIOD_NS / nsPerTick), std::memory_order_relaxed);
+    g_tsc.m_isUsed.store(true, std::memory_order_release);
+    return true;
+}
+
+bool IsTscClock()
+{
+    return g_tsc.m_isUsed.load(std::memory_order_acquire);
+}
+
+uint64_t ClockTicks()
+{
+    return IsTscClock() ? ReadTsc() : SteadyNanoseconds();
+}
+
+uint64_t ElapsedNanoseconds(uint64_t startTicks, uint64_t endTicks)
+{
+    if (endTicks <= startTicks)
+        return 0;
+    if (!IsTscClock())
+        return endTicks - startTicks;
+
+    Recalibrate(endTicks);
+    return static_cast<uint64_t>(static_cast<double>(endTicks - startTicks) * g_tsc.m_nsPerTick.load(std::memory_order_relaxed));
+}
+
+int64_t WallClockMicroseconds()
+{
+    if (!IsTscClock())
+        return SystemMicroseconds();
+
+    const uint64_t ticks = ReadTsc();
+    Recalibrate(ticks);
+    return g_tsc.m_baseSystemUs + static_cast<int64_t>(ElapsedNanoseconds(g_tsc.m_baseTicks, ticks) / 1000);
+}
@@ -0,0 +1,40 @@
+/**
+ * @file FastClock.h
+ * @brief Clock of the timers and record timestamps: steady_clock or the CPU timestamp counter.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Switches between the timestamp counter (TSC) and steady_clock.
+ * @return true if the TSC is in use. It is only used when the CPU reports an invariant
+ * TSC (constant rate, not stopped in sleep states), otherwise steady_clock stays in use.
+ * @note The TSC rate is calibrated against steady_clock when it is enabled and refined
+ * about once a second afterwards. Timers running while the clock is switched report
+ * meaningless durations.
+ */
+bool SetTscClock(bool isEnabled);
+
+/**
+ * @brief Returns true if the TSC is in use.
+ */
+bool IsTscClock();
+
+/**
+ * @brief Raw reading of the clock in use: TSC ticks or steady_clock nanoseconds.
+ */
+uint64_t ClockTicks();
+
+/**
+ * @brief Converts the difference of two ClockTicks readings to nanoseconds.
+ */
+uint64_t ElapsedNanoseconds(uint64_t startTicks, uint64_t endTicks);
+
+/**
+ * @brief Current time in microseconds since the Unix epoch.
+ * @note With the TSC, the time is derived from the counter and the system time read
+ * when the TSC was enabled, which avoids a system call per record.
+ */
+int64_t WallClockMicroseconds();
@@ -0,0 +1,416 @@
+#include "FileSinks.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+#define MAPPED_FILE_CHUNK_SIZE (4 * 1024 * 1024)
+#define STREAM_BUFFER_SIZE (64 * 1024)
+
+#ifdef _WIN32
+    using FileHandle = HANDLE;
+    const FileHandle InvalidFile = INVALID_HANDLE_VALUE;
+
+    FileHandle OpenLogFile(const std::string& path)
+    {
+        return CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    FileHandle OpenLogFileForAppend(const std::string& path)
+    {
+        return CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    void AppendLogFile(FileHandle file, const char* data, size_t size)
+    {
+        // Both offsets set to 0xFFFFFFFF write to the current end of the file.
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = 0xFFFFFFFF;
+        overlapped.OffsetHigh = 0xFFFFFFFF;
+        DWORD written = 0;
+        WriteFile(file, data, static_cast<DWORD>(size), &written, &overlapped);
+    }
+
+    void SyncLogFile(FileHandle file)
+    {
+        FlushFileBuffers(file);
+    }
+
+    void SyncLogFileView(char* view, size_t size)
+    {
+        FlushViewOfFile(view, size);
+    }
+
+    void CloseLogFile(FileHandle file)
+    {
+        CloseHandle(file);
+    }
+
+    uint64_t LogFileSize(FileHandle file)
+    {
+        LARGE_INTEGER size;
+        return GetFileSizeEx(file, &size) ? static_cast<uint64_t>(size.QuadPart) : 0;
+    }
+
+    bool ResizeLogFile(FileHandle file, uint64_t size)
+    {
+        LARGE_INTEGER pos;
+        pos.QuadPart = static_cast<LONGLONG>(size);
+        return SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+    }
+
+    size_t MapGranularity()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+    }
+
+    char* MapLogFile(FileHandle file, uint64_t offset, size_t size, HANDLE& mapping)
+    {
+        const uint64_t end = offset + size;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), nullptr);
+        if (!mapping)
+            return nullptr;
+        void* view = MapViewOfFile(mapping, FILE_MAP_WRITE,
+            static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), size);
+        if (!view)
+        {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+        return static_cast<char*>(view);
+    }
+
+    void UnmapLogFile(char* view, size_t, HANDLE& mapping)
+    {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+
+    void WriteLogFileAt(FileHandle file, uint64_t offset, const char* data, size_t size)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        WriteFile(file, data, static_cast<DWORD>(size), &written, &overlapped);
+    }
+#else
+    using FileHandle = int;
+    const FileHandle InvalidFile = -1;
+
+    FileHandle OpenLogFile(const std::string& path)
+    {
+        return ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+
+    FileHandle OpenLogFileForAppend(const std::string& path)
+    {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+
+    void AppendLogFile(FileHandle file, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = ::write(file, data, size);
+            if (written <= 0)
+                return;
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void SyncLogFile(FileHandle file)
+    {
+#ifdef __linux__
+        ::fdatasync(file);
+#else
+        ::fsync(file);
+#endif
+    }
+
+    void SyncLogFileView(char* view, size_t size)
+    {
+        ::msync(view, size, MS_SYNC);
+    }
+
+    void CloseLogFile(FileHandle file)
+    {
+        ::close(file);
+    }
+
+    uint64_t LogFileSize(FileHandle file)
+    {
+        struct stat info;
+        return ::fstat(file, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+    }
+
+    bool ResizeLogFile(FileHandle file, uint64_t size)
+    {
+        return ::ftruncate(file, static_cast<off_t>(size)) == 0;
+    }
+
+    size_t MapGranularity()
+    {
+        return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    char* MapLogFile(FileHandle file, uint64_t offset, size_t size, void*&)
+    {
+        void* view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, static_cast<off_t>(offset));
+        return view == MAP_FAILED ? nullptr : static_cast<char*>(view);
+    }
+
+    void UnmapLogFile(char* view, size_t size, void*&)
+    {
+        ::munmap(view, size);
+    }
+
+    void WriteLogFileAt(FileHandle file, uint64_t offset, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = ::pwrite(file, data, size, static_cast<off_t>(offset));
+            if (written <= 0)
+                return;
+            data += written;
+            offset += static_cast<uint64_t>(written);
+            size -= static_cast<size_t>(written);
+        }
+    }
+#endif
+
+    /**
+     * @brief Collects records in a buffer and appends it to the file when it is full,
+     * on flush and on sync.
+     */
+    struct sStreamFileSink : sFileSink
+    {
+        explicit sStreamFileSink(const std::string& path)
+            : m_file(OpenLogFileForAppend(path))
+        {
+            m_buffer.reserve(STREAM_BUFFER_SIZE);
+            if (m_file != InvalidFile)
+                m_size = LogFileSize(m_file);
+        }
+
+        ~sStreamFileSink() override
+        {
+            if (m_file == InvalidFile)
+                return;
+            flush();
+            CloseLogFile(m_file);
+        }
+
+        void write(const char* data, size_t size) override
+        {
+            if (m_file == InvalidFile)
+                return;
+            m_size += size;
+            if (m_buffer.size() + size > STREAM_BUFFER_SIZE)
+                flush();
+            if (size >= STREAM_BUFFER_SIZE)
+                AppendLogFile(m_file, data, size);
+            else
+                m_buffer.append(data, size);
+        }
+
+        void flush() override
+        {
+            if (m_buffer.empty())
+                return;
+            AppendLogFile(m_file, m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+        }
+
+        void sync() override
+        {
+            if (m_file == InvalidFile)
+                return;
+            flush();
+            SyncLogFile(m_file);
+        }
+
+        uint64_t size() const override
+        {
+            return m_size;
+        }
+
+        FileHandle m_file;
+        std::string m_buffer;
+        uint64_t m_size = 0;
+    };
+
+    struct sOpenCloseFileSink : sFileSink
+    {
+        explicit sOpenCloseFileSink(const std::string& path)
+            : m_path(path)
+        {
+            const FileHandle file = OpenLogFileForAppend(m_path);
+            if (file == InvalidFile)
+                return;
+            m_size = LogFileSize(file);
+            CloseLogFile(file);
+        }
+
+        void write(const char* data, size_t size) override
+        {
+            const FileHandle file = OpenLogFileForAppend(m_path);
+            if (file == InvalidFile)
+                return;
+            AppendLogFile(file, data, size);
+            CloseLogFile(file);
+            m_size += size;
+        }
+
+        void sync() override
+        {
+            const FileHandle file = OpenLogFileForAppend(m_path);
+            if (file == InvalidFile)
+                return;
+            SyncLogFile(file);
+            CloseLogFile(file);
+        }
+
+        uint64_t size() const override
+        {
+            return m_size;
+        }
+
+        std::string m_path;
+        uint64_t m_size = 0;
+    };
+
+    /**
+     * @brief Copies records straight into a shared mapping of the file.
+     * @note The file is extended one chunk ahead of the data and truncated to the real
+     * length when the sink is destroyed. Until then readers see zero padding after the
+     * last record. If mapping fails the data is written with positioned writes instead.
+     */
+    struct sMappedFileSink : sFileSink
+    {
+        sMappedFileSink(const std::string& path, size_t chunkSize)
+            : m_file(OpenLogFile(path))
+            , m_granularity(MapGranularity())
+            , m_chunkSize(std::max(chunkSize, m_granularity))
+        {
+            if (m_file != InvalidFile)
+                m_offset = LogFileSize(m_file);
+        }
+
+        ~sMappedFileSink() override
+        {
+            if (m_file == InvalidFile)
+                return;
+            unmap();
+            ResizeLogFile(m_file, m_offset);
+            CloseLogFile(m_file);
+        }
+
+        void write(const char* data, size_t size) override
+        {
+            if (m_file == InvalidFile)
+                return;
+
+            while (size > 0)
+            {
+                if (!m_view || m_offset >= m_viewOffset + m_viewSize)
+                {
+                    if (!remap())
+                    {
+                        WriteLogFileAt(m_file, m_offset, data, size);
+                        m_offset += size;
+                        return;
+                    }
+                }
+
+                const size_t room = static_cast<size_t>(m_viewOffset + m_viewSize - m_offset);
+                const size_t count = std::min(room, size);
+                std::memcpy(m_view + (m_offset - m_viewOffset), data, count);
+                m_offset += count;
+                data += count;
+                size -= count;
+            }
+        }
+
+        void sync() override
+        {
+            if (m_file == InvalidFile)
+                return;
+            if (m_view)
+                SyncLogFileView(m_view, static_cast<size_t>(m_offset - m_viewOffset));
+            SyncLogFile(m_file);
+        }
+
+        uint64_t size() const override
+        {
+            return m_offset;
+        }
+
+    private:
+        bool remap()
+        {
+            unmap();
+            m_viewOffset = m_offset - m_offset % m_granularity;
+            m_viewSize = static_cast<size_t>(m_offset - m_viewOffset) + m_chunkSize;
+
+            const uint64_t end = m_viewOffset + m_viewSize;
+            if (LogFileSize(m_file) < end && !ResizeLogFile(m_file, end))
+                return false;
+            m_view = MapLogFile(m_file, m_viewOffset, m_viewSize, m_mapping);
+            return m_view != nullptr;
+        }
+
+        void unmap()
+        {
+            if (m_view)
+                UnmapLogFile(m_view, m_viewSize, m_mapping);
+            m_view = nullptr;
+        }
+
+        FileHandle m_file;
+        const size_t m_granularity;
+        const size_t m_chunkSize;
+        uint64_t m_offset = 0;      //!< End of the written data
+        uint64_t m_viewOffset = 0;  //!< File offset of the mapped view
+        size_t m_viewSize = 0;
+        char* m_view = nullptr;
+#ifdef _WIN32
+        HANDLE m_mapping = nullptr;
+#else
+        void* m_mapping = nullptr;
+#endif
+    };
+}
+
+std::unique_ptr<sFileSink> CreateFileSink(eFileSinkKind kind, const std::string& path)
+{
+    if (path.empty())
+        return nullptr;
+
+    if (kind == eFileSinkKind::OpenClose)
+        return std::make_unique<sOpenCloseFileSink>(path);
+    if (kind == eFileSinkKind::Mapped)
+        return std::make_unique<sMappedFileSink>(path, MAPPED_FILE_CHUNK_SIZE);
+    return std::make_unique<sStreamFileSink>(path);
+}
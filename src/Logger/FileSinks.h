@@ -0,0 +1,57 @@
+/**
+ * @file FileSinks.h
+ * @brief File outputs used by the logger.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Strategy used to write the log file.
+ */
+enum class eFileSinkKind : uint8_t
+{
+    Stream,     //!< Buffered file kept open
+    OpenClose,  //!< File opened and closed for every record
+    Mapped      //!< File pre-extended in chunks and written through a memory mapping
+};
+
+/**
+ * @brief Destination of the plain text of the records.
+ */
+struct sFileSink
+{
+    virtual ~sFileSink() = default;
+
+    /**
+     * @brief Appends the data to the file.
+     */
+    virtual void write(const char* data, size_t size) = 0;
+
+    /**
+     * @brief Hands buffered data over to the operating system.
+     */
+    virtual void flush()
+    {
+    }
+
+    /**
+     * @brief Flushes and waits until the written data is stored on the device.
+     */
+    virtual void sync() = 0;
+
+    /**
+     * @brief Length of the file including the data that is still buffered.
+     */
+    virtual uint64_t size() const = 0;
+};
+
+/**
+ * @brief Creates a sink that appends to the file.
+ * @return nullptr if the path is empty.
+ */
+std::unique_ptr<sFileSink> CreateFileSink(eFileSinkKind kind, const std::string& path);
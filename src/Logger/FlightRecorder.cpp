@@ -0,0 +1,222 @@
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+#define DUMP_HEADER_BEGIN "----- flight recorder dump: "
+#define DUMP_HEADER_END " -----\n"
+
+    // The recorder the signal handlers dump, nullptr if none handles signals.
+    std::atomic<sFlightRecorder*> g_signalRecorder{ nullptr };
+
+    const int HandledSignals[] = { SIGSEGV, SIGABRT };
+
+#ifdef _WIN32
+    using DumpFile = HANDLE;
+    const DumpFile InvalidDumpFile = INVALID_HANDLE_VALUE;
+
+    DumpFile OpenDumpFile(const char* path)
+    {
+        return CreateFileA(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    void WriteDumpFile(DumpFile file, const char* data, size_t size)
+    {
+        DWORD written = 0;
+        WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr);
+    }
+
+    void CloseDumpFile(DumpFile file)
+    {
+        CloseHandle(file);
+    }
+
+    using SignalAction = void (*)(int);
+    SignalAction g_previousActions[2] = {};
+
+    void InstallHandler(size_t i, void (*handler)(int))
+    {
+        g_previousActions[i] = std::signal(HandledSignals[i], handler);
+    }
+
+    void RestoreHandler(size_t i)
+    {
+        std::signal(HandledSignals[i], g_previousActions[i] == SIG_ERR ? SIG_DFL : g_previousActions[i]);
+    }
+#else
+    using DumpFile = int;
+    const DumpFile InvalidDumpFile = -1;
+
+    // Only async-signal-safe calls, the functions run in the signal handler.
+    DumpFile OpenDumpFile(const char* path)
+    {
+        return ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    }
+
+    void WriteDumpFile(DumpFile file, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = ::write(file, data, size);
+            if (written <= 0)
+                return;
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void CloseDumpFile(DumpFile file)
+    {
+        ::close(file);
+    }
+
+    struct sigaction g_previousActions[2];
+
+    void InstallHandler(size_t i, void (*handler)(int))
+    {
+        struct sigaction action = {};
+        action.sa_handler = handler;
+        sigemptyset(&action.sa_mask);
+        sigaction(HandledSignals[i], &action, &g_previousActions[i]);
+    }
+
+    void RestoreHandler(size_t i)
+    {
+        sigaction(HandledSignals[i], &g_previousActions[i], nullptr);
+    }
+#endif
+
+    void RestoreHandlers()
+    {
+        for (size_t i = 0; i < sizeof(HandledSignals) / sizeof(HandledSignals[0]); ++i)
+            RestoreHandler(i);
+    }
+
+    // snprintf is not async-signal-safe.
+    void SignalReason(int signal, char* out)
+    {
+        const char prefix[] = "signal ";
+        std::memcpy(out, prefix, sizeof(prefix) - 1);
+        out += sizeof(prefix) - 1;
+        char digits[12];
+        int count = 0;
+        unsigned value = static_cast<unsigned>(signal);
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (count > 0)
+            *out++ = digits[--count];
+        *out = '\0';
+    }
+}
+
+sFlightRecorder::sFlightRecorder(size_t capacity, const std::string& dumpPath, bool dumpOnError, bool handleSignals)
+    : m_capacity(std::max<size_t>(capacity, 1))
+    , m_buffer(new char[m_capacity])
+    , m_dumpOnError(dumpOnError)
+{
+    // Touches every page, so recording never faults a page in.
+    std::memset(m_buffer.get(), 0, m_capacity);
+    std::strncpy(m_path, dumpPath.c_str(), PATH_CAPACITY - 1);
+
+    sFlightRecorder* expected = nullptr;
+    if (handleSignals && g_signalRecorder.compare_exchange_strong(expected, this))
+    {
+        m_handlesSignals = true;
+        for (size_t i = 0; i < sizeof(HandledSignals) / sizeof(HandledSignals[0]); ++i)
+            InstallHandler(i, &sFlightRecorder::OnSignal);
+    }
+}
+
+sFlightRecorder::~sFlightRecorder()
+{
+    if (!m_handlesSignals)
+        return;
+    RestoreHandlers();
+    g_signalRecorder.store(nullptr);
+}
+
+void sFlightRecorder::add(const char* data, size_t size)
+{
+    // Only the tail of a record longer than the ring fits.
+    if (size > m_capacity)
+    {
+        data += size - m_capacity;
+        size = m_capacity;
+    }
+    const uint64_t begin = m_written.fetch_add(size, std::memory_order_relaxed);
+    const size_t offset = static_cast<size_t>(begin % m_capacity);
+    const size_t first = std::min(size, m_capacity - offset);
+    std::memcpy(m_buffer.get() + offset, data, first);
+    std::memcpy(m_buffer.get(), data + first, size - first);
+}
+
+void sFlightRecorder::dump(const char* reason)
+{
+    std::lock_guard<std::mutex> lock(m_dumpMtx);
+    dumpUnlocked(reason);
+}
+
+void sFlightRecorder::dumpUnlocked(const char* reason)
+{
+    const uint64_t written = m_written.load(std::memory_order_acquire);
+    uint64_t from = std::max(m_dumped, written > m_capacity ? written - m_capacity : 0);
+    if (from >= written)
+        return;
+
+    // The oldest record was partly overwritten, the dump starts at the next whole one.
+    if (from > m_dumped)
+    {
+        while (from < written && m_buffer[static_cast<size_t>(from % m_capacity)] != '\n')
+            ++from;
+        ++from;
+        if (from >= written)
+            return;
+    }
+
+    const DumpFile file = OpenDumpFile(m_path);
+    if (file == InvalidDumpFile)
+        return;
+    WriteDumpFile(file, DUMP_HEADER_BEGIN, sizeof(DUMP_HEADER_BEGIN) - 1);
+    WriteDumpFile(file, reason, std::strlen(reason));
+    WriteDumpFile(file, DUMP_HEADER_END, sizeof(DUMP_HEADER_END) - 1);
+
+    const size_t offset = static_cast<size_t>(from % m_capacity);
+    const size_t size = static_cast<size_t>(written - from);
+    const size_t first = std::min(size, m_capacity - offset);
+    WriteDumpFile(file, m_buffer.get() + offset, first);
+    WriteDumpFile(file, m_buffer.get(), size - first);
+    CloseDumpFile(file);
+    m_dumped = written;
+}
+
+void sFlightRecorder::OnSignal(int signal)
+{
+    // The mutex is not taken: the crashed thread may hold it, and the process ends anyway.
+    sFlightRecorder* recorder = g_signalRecorder.exchange(nullptr);
+    if (recorder)
+    {
+        char reason[32];
+        SignalReason(signal, reason);
+        recorder->dumpUnlocked(reason);
+    }
+    // The previous handler (by default the one ending the process) gets the signal next.
+    RestoreHandlers();
+    std::raise(signal);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file FlightRecorder.h
+ * @brief In-memory ring of the last records, written to a file only when it is dumped.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Preallocated byte ring holding the plain text of the most recent records.
+ * @note Writers reserve their bytes with one atomic add and copy the record in, without a
+ * lock and without I/O. A dump appends the records that were not dumped before to the dump
+ * file. A record still being copied while the ring is dumped may come out incomplete.
+ */
+struct sFlightRecorder
+{
+    sFlightRecorder(size_t capacity, const std::string& dumpPath, bool dumpOnError, bool handleSignals);
+    ~sFlightRecorder();
+
+    sFlightRecorder(const sFlightRecorder&) = delete;
+    sFlightRecorder& operator=(const sFlightRecorder&) = delete;
+
+    /**
+     * @brief Copies a record into the ring, the oldest records are overwritten.
+     */
+    void add(const char* data, size_t size);
+
+    /**
+     * @brief Appends the records added since the last dump to the dump file.
+     * @param reason Written in the line that starts the dump.
+     */
+    void dump(const char* reason);
+
+    bool dumpsOnError() const
+    {
+        return m_dumpOnError;
+    }
+
+private:
+    static void OnSignal(int signal);
+    void dumpUnlocked(const char* reason);
+
+    static constexpr size_t PATH_CAPACITY = 1024;
+
+    const size_t m_capacity;
+    std::unique_ptr<char[]> m_buffer;
+    std::atomic<uint64_t> m_written{ 0 };   //!< Bytes ever added, the ring holds the last m_capacity of them
+    uint64_t m_dumped = 0;                  //!< Bytes already dumped
+    char m_path[PATH_CAPACITY] = {};        //!< Plain array, the signal handler may not allocate
+    const bool m_dumpOnError;
+    bool m_handlesSignals = false;
+    std::mutex m_dumpMtx;
+};
@@ -0,0 +1,101 @@
+/**
+ * @file LatencyHistogram.h
+ * @brief Log-bucketed histogram of durations.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief HDR-style histogram of durations in nanoseconds that keeps only bucket counts.
+ * @note Every power of two is split into 32 linear buckets, so a percentile is reported
+ * within about 3% of the exact value. Durations up to 2^40 ns (about 18 minutes) are
+ * bucketed, longer ones fall into the last bucket. min, max and the sum are exact.
+ */
+struct sLatencyHistogram
+{
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_MAGNITUDE = 40;
+    static constexpr size_t BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::array<uint64_t, BUCKETS> m_counts{};
+    uint64_t m_count = 0;
+    uint64_t m_min = UINT64_MAX;
+    uint64_t m_max = 0;
+    uint64_t m_sum = 0;
+
+    void record(uint64_t ns)
+    {
+        ++m_counts[bucketOf(ns)];
+        ++m_count;
+        m_min = std::min(m_min, ns);
+        m_max = std::max(m_max, ns);
+        m_sum += ns;
+    }
+
+    void merge(const sLatencyHistogram& other)
+    {
+        for (size_t i = 0; i < BUCKETS; ++i)
+            m_counts[i] += other.m_counts[i];
+        m_count += other.m_count;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        m_sum += other.m_sum;
+    }
+
+    void reset()
+    {
+        *this = sLatencyHistogram();
+    }
+
+    /**
+     * @brief Returns the value below which the given fraction of the samples lies.
+     */
+    uint64_t percentile(double fraction) const
+    {
+        if (m_count == 0)
+            return 0;
+        const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(m_count - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += m_counts[i];
+            if (seen > rank)
+                return std::min(std::max(valueOf(i), m_min), m_max);
+        }
+        return m_max;
+    }
+
+    double mean() const
+    {
+        return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.0;
+    }
+
+private:
+    static size_t bucketOf(uint64_t ns)
+    {
+        if (ns < SUB_BUCKETS)
+            return static_cast<size_t>(ns);
+        int magnitude = 63;
+        while (!(ns >> magnitude))
+            --magnitude;
+        if (magnitude >= MAX_MAGNITUDE)
+            return BUCKETS - 1;
+        const int shift = magnitude - SUB_BUCKET_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((ns >> shift) & (SUB_BUCKETS - 1)));
+    }
+
+    // Middle of the bucket.
+    static uint64_t valueOf(size_t bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+        const int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+        return (static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift) + ((1ull << shift) >> 1);
+    }
+};
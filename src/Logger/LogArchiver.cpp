@@ -0,0 +1,207 @@
+#include "LogArchiver.h"
+#include "Compression.h"
+#include "LogIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+#define COMPRESSED_SEGMENT_EXT ".lz4"
+#define TEMPORARY_FILE_EXT ".tmp"
+#define SEGMENT_KEY_PATTERN "dddddddd-dddddd-dddddd"   // Local time of the rotation and sequence number
+#define SEGMENT_STAMP_LENGTH 15
+#define SEGMENT_SEQUENCE_DIGITS 6
+
+    namespace fs = std::filesystem;
+
+    void LowerCurrentThreadPriority()
+    {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+        // On Linux the nice value is per thread.
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    }
+
+    bool EndsWith(const std::string& text, const char* suffix)
+    {
+        const std::string tail(suffix);
+        return text.size() >= tail.size() && text.compare(text.size() - tail.size(), tail.size(), tail) == 0;
+    }
+
+    // Name of the segment after the log file name and without the compression or index extension,
+    // which gives the rotation order. Empty if the file is not a segment of the log file.
+    std::string SegmentKey(const std::string& name, const std::string& prefix)
+    {
+        if (name.compare(0, prefix.size(), prefix) != 0)
+            return std::string();
+        std::string key = name.substr(prefix.size());
+        if (EndsWith(key, COMPRESSED_SEGMENT_EXT))
+            key.resize(key.size() - std::string(COMPRESSED_SEGMENT_EXT).size());
+        else if (EndsWith(key, LogIndexExtension))
+            key.resize(key.size() - std::string(LogIndexExtension).size());
+
+        static const char pattern[] = SEGMENT_KEY_PATTERN;
+        if (key.size() != sizeof(pattern) - 1)
+            return std::string();
+        for (size_t i = 0; i < key.size(); ++i)
+        {
+            const bool isDigit = key[i] >= '0' && key[i] <= '9';
+            if (pattern[i] == 'd' ? !isDigit : key[i] != pattern[i])
+                return std::string();
+        }
+        return key;
+    }
+
+    // The segments of the log file with their keys, the segment files and their indexes.
+    std::vector<std::pair<std::string, fs::path>> FindSegments(const std::string& logPath)
+    {
+        const fs::path log(logPath);
+        const fs::path directory = log.has_parent_path() ? log.parent_path() : fs::path(".");
+        const std::string prefix = log.filename().string() + ".";
+
+        std::vector<std::pair<std::string, fs::path>> segments;
+        std::error_code error;
+        for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+        {
+            std::string key = SegmentKey(it->path().filename().string(), prefix);
+            if (!key.empty())
+                segments.emplace_back(std::move(key), it->path());
+        }
+        return segments;
+    }
+}
+
+std::string NextLogSegmentPath(const std::string& path)
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+
+    // The sequence continues after the newest segment of the same second, so a name is never
+    // reused and sorts after all the segments before it, whichever of them are pruned.
+    unsigned long sequence = 1;
+    for (const auto& segment : FindSegments(path))
+    {
+        if (segment.first.compare(0, SEGMENT_STAMP_LENGTH, stamp) == 0)
+            sequence = std::max(sequence, std::strtoul(segment.first.c_str() + SEGMENT_STAMP_LENGTH + 1, nullptr, 10) + 1);
+    }
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "-%0*lu", SEGMENT_SEQUENCE_DIGITS, sequence);
+    return path + "." + stamp + suffix;
+}
+
+sLogArchiver::sLogArchiver(unsigned maxFiles, bool compress)
+    : m_maxFiles(maxFiles)
+    , m_compress(compress)
+{
+    m_thread = std::thread(&sLogArchiver::run, this);
+}
+
+sLogArchiver::~sLogArchiver()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void sLogArchiver::add(const std::string& segmentPath, const std::string& logPath)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_queue.push_back({ segmentPath, logPath });
+    }
+    m_cv.notify_one();
+}
+
+void sLogArchiver::run()
+{
+    LowerCurrentThreadPriority();
+
+    std::unique_lock<std::mutex> lock(m_mtx);
+    for (;;)
+    {
+        m_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty())
+            return;
+
+        const sSegment segment = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        archive(segment);
+        lock.lock();
+    }
+}
+
+void sLogArchiver::archive(const sSegment& segment)
+{
+    if (m_compress)
+    {
+        // Written under a temporary name, so a crash never leaves a truncated archive behind.
+        const std::string archivePath = segment.m_path + COMPRESSED_SEGMENT_EXT;
+        const std::string temporaryPath = archivePath + TEMPORARY_FILE_EXT;
+        std::error_code error;
+        if (CompressFileLz4(segment.m_path, temporaryPath))
+        {
+            fs::rename(temporaryPath, archivePath, error);
+            if (!error)
+                fs::remove(segment.m_path, error);
+        }
+        else
+            fs::remove(temporaryPath, error);
+    }
+
+    if (m_maxFiles > 0)
+        prune(segment.m_logPath);
+}
+
+void sLogArchiver::prune(const std::string& logPath)
+{
+    // Other files named after the log file, its index or a copy of the user, are left alone.
+    const std::vector<std::pair<std::string, fs::path>> segments = FindSegments(logPath);
+
+    // A segment and its index share the key and are removed together.
+    std::vector<std::string> keys;
+    for (const auto& segment : segments)
+        keys.push_back(segment.first);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    if (keys.size() <= m_maxFiles)
+        return;
+
+    const std::string& oldestKept = keys[keys.size() - m_maxFiles];
+    std::error_code error;
+    for (const auto& segment : segments)
+    {
+        if (segment.first < oldestKept)
+            fs::remove(segment.second, error);
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file LogArchiver.h
+ * @brief Background compression and retention of rotated log files.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Returns a free path for the next rotated segment of the log file.
+ * @note The segment name is the log file name followed by the local time of the rotation and
+ * a sequence number within that second, "<log file>.<YYYYMMDD-HHMMSS>-<NNNNNN>", so the
+ * segments of one log file sort by name in the order they were written.
+ */
+std::string NextLogSegmentPath(const std::string& path);
+
+/**
+ * @brief Compresses rotated segments and removes the oldest ones on a low-priority thread.
+ * @note The logger only renames the full file and hands the segment over, so a rotation
+ * costs a rename and an open on the logging path.
+ */
+struct sLogArchiver
+{
+    /**
+     * @param maxFiles Number of rotated segments kept per log file, 0 keeps all of them.
+     * @param compress Whether the segments are compressed into LZ4 frames (".lz4").
+     */
+    sLogArchiver(unsigned maxFiles, bool compress);
+
+    /**
+     * @brief Finishes the queued segments and stops the thread.
+     */
+    ~sLogArchiver();
+
+    sLogArchiver(const sLogArchiver&) = delete;
+    sLogArchiver& operator=(const sLogArchiver&) = delete;
+
+    /**
+     * @brief Queues a segment rotated out of the log file at logPath.
+     */
+    void add(const std::string& segmentPath, const std::string& logPath);
+
+private:
+    struct sSegment
+    {
+        std::string m_path;
+        std::string m_logPath;
+    };
+
+    void run();
+    void archive(const sSegment& segment);
+    void prune(const std::string& logPath);
+
+    const unsigned m_maxFiles;
+    const bool m_compress;
+    std::deque<sSegment> m_queue;
+    bool m_stop = false;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
@@ -0,0 +1,347 @@
+#include "LogArgs.h"
+#include "LogFormatCore.h"
+
+#include <cstdio>
+
+namespace
+{
+// A width or precision of more digits does not fit into an int.
+#define MAX_SPEC_DIGITS 10
+// "%", each of the six flags once, two numbers of up to 11 characters ("-2147483648"),
+// '.', a length modifier of two characters, the conversion and the terminating zero.
+#define SPEC_CAPACITY 34
+
+    struct sArgReader
+    {
+        const char* m_pos;
+        const char* m_end;
+
+        bool next(eLogArgType& type)
+        {
+            if (m_pos >= m_end)
+                return false;
+            type = static_cast<eLogArgType>(*m_pos++);
+            return true;
+        }
+
+        template <typename T>
+        T read()
+        {
+            T value;
+            std::memcpy(&value, m_pos, sizeof(T));
+            m_pos += sizeof(T);
+            return value;
+        }
+
+        // The text is followed by a terminating zero.
+        std::string_view readString()
+        {
+            const auto size = read<uint32_t>();
+            const char* str = m_pos;
+            m_pos += size + 1;
+            return std::string_view(str, size);
+        }
+
+        void skip(eLogArgType type)
+        {
+            switch (type)
+            {
+            case eLogArgType::Int: read<int>(); break;
+            case eLogArgType::UInt: read<unsigned int>(); break;
+            case eLogArgType::Long: read<long>(); break;
+            case eLogArgType::ULong: read<unsigned long>(); break;
+            case eLogArgType::LongLong: read<long long>(); break;
+            case eLogArgType::ULongLong: read<unsigned long long>(); break;
+            case eLogArgType::Double: read<double>(); break;
+            case eLogArgType::LongDouble: read<long double>(); break;
+            case eLogArgType::Pointer: read<const void*>(); break;
+            case eLogArgType::String: readString(); break;
+            }
+        }
+    };
+
+    bool IsIntConversion(char conv)
+    {
+        return conv == 'd' || conv == 'i' || conv == 'o' || conv == 'u'
+            || conv == 'x' || conv == 'X' || conv == 'c';
+    }
+
+    bool IsFloatConversion(char conv)
+    {
+        return conv == 'f' || conv == 'F' || conv == 'e' || conv == 'E'
+            || conv == 'g' || conv == 'G' || conv == 'a' || conv == 'A';
+    }
+
+    // Integer conversions without flags or width, the length modifier is implied by the captured type.
+    template <typename T>
+    bool AppendPlainInteger(std::string& out, bool isPlain, char conv, T value)
+    {
+        if (!isPlain)
+            return false;
+        if (conv == 'd' || conv == 'i')
+            AppendInteger(out, static_cast<std::make_signed_t<T>>(value));
+        else if (conv == 'u')
+            AppendInteger(out, static_cast<std::make_unsigned_t<T>>(value));
+        else
+            return false;
+        return true;
+    }
+
+    // Precision of a specification that has no flags or width, e.g. 3 for "%.3"; -1 otherwise.
+    int PlainPrecision(const char* spec, size_t specLen)
+    {
+        if (specLen == 1)
+            return 6;
+        if (spec[1] != '.')
+            return -1;
+        int precision = 0;
+        for (size_t i = 2; i < specLen; ++i)
+        {
+            if (spec[i] < '0' || spec[i] > '9' || precision > 1000)
+                return -1;
+            precision = precision * 10 + (spec[i] - '0');
+        }
+        return precision;
+    }
+
+    template <typename... Values>
+    void AppendFormatted(std::string& out, const char* spec, Values... values)
+    {
+        const size_t oldSize = out.size();
+        size_t room = 64;
+        for (;;)
+        {
+            out.resize(oldSize + room);
+            const int written = std::snprintf(&out[oldSize], room, spec, values...);
+            if (written < 0)
+            {
+                out.resize(oldSize);
+                return;
+            }
+            if (static_cast<size_t>(written) < room)
+            {
+                out.resize(oldSize + static_cast<size_t>(written));
+                return;
+            }
+            room = static_cast<size_t>(written) + 1;
+        }
+    }
+
+    // Formats one value. spec holds "%", the flags, width and precision, lengthPos marks
+    // where the length modifier and the conversion are written.
+    void AppendArg(std::string& out, char* spec, size_t lengthPos, char conv,
+        eLogArgType type, sArgReader& reader)
+    {
+        auto setConversion = [&](const char* length, char conversion) {
+            size_t pos = lengthPos;
+            for (; *length; ++length)
+                spec[pos++] = *length;
+            spec[pos++] = conversion;
+            spec[pos] = '\0';
+        };
+        // The default conversion of the captured type, used on a mismatch.
+        auto resetSpec = [&](const char* length, char conversion) {
+            lengthPos = 1;
+            setConversion(length, conversion);
+        };
+
+        // snprintf is only used for flags, widths and the less common conversions.
+        const bool isPlain = lengthPos == 1;
+        switch (type)
+        {
+        case eLogArgType::Int:
+        {
+            const auto value = reader.read<int>();
+            if (AppendPlainInteger(out, isPlain, conv, value))
+                break;
+            IsIntConversion(conv) ? setConversion("", conv) : resetSpec("", 'd');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::UInt:
+        {
+            const auto value = reader.read<unsigned int>();
+            if (AppendPlainInteger(out, isPlain, conv, value))
+                break;
+            IsIntConversion(conv) ? setConversion("", conv) : resetSpec("", 'u');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::Long:
+        {
+            const auto value = reader.read<long>();
+            if (AppendPlainInteger(out, isPlain, conv, value))
+                break;
+            IsIntConversion(conv) && conv != 'c' ? setConversion("l", conv) : resetSpec("l", 'd');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::ULong:
+        {
+            const auto value = reader.read<unsigned long>();
+            if (AppendPlainInteger(out, isPlain, conv, value))
+                break;
+            IsIntConversion(conv) && conv != 'c' ? setConversion("l", conv) : resetSpec("l", 'u');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::LongLong:
+        {
+            const auto value = reader.read<long long>();
+            if (AppendPlainInteger(out, isPlain, conv, value))
+                break;
+            IsIntConversion(conv) && conv != 'c' ? setConversion("ll", conv) : resetSpec("ll", 'd');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::ULongLong:
+        {
+            const auto value = reader.read<unsigned long long>();
+            if (AppendPlainInteger(out, isPlain, conv, value))
+                break;
+            IsIntConversion(conv) && conv != 'c' ? setConversion("ll", conv) : resetSpec("ll", 'u');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::Double:
+        {
+            const auto value = reader.read<double>();
+            const int precision = conv == 'f' || conv == 'e' || conv == 'g' ? PlainPrecision(spec, lengthPos) : -1;
+            if (precision >= 0)
+            {
+                AppendFloat(out, value, conv == 'f' ? std::chars_format::fixed
+                    : conv == 'e' ? std::chars_format::scientific : std::chars_format::general, precision);
+                break;
+            }
+            IsFloatConversion(conv) ? setConversion("", conv) : resetSpec("", 'g');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::LongDouble:
+        {
+            const auto value = reader.read<long double>();
+            IsFloatConversion(conv) ? setConversion("L", conv) : resetSpec("L", 'g');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::Pointer:
+        {
+            const auto value = reader.read<const void*>();
+            resetSpec("", 'p');
+            AppendFormatted(out, spec, value);
+            break;
+        }
+        case eLogArgType::String:
+        {
+            const std::string_view value = reader.readString();
+            if (isPlain)
+            {
+                out.append(value.data(), value.size());
+                break;
+            }
+            conv == 's' ? setConversion("", 's') : resetSpec("", 's');
+            AppendFormatted(out, spec, value.data());
+            break;
+        }
+        }
+    }
+}
+
+void FormatLogArgs(const char* format, const char* args, size_t size, std::string& out)
+{
+    sArgReader reader{ args, args + size };
+    const char* pos = format;
+    while (*pos)
+    {
+        const char* percent = std::strchr(pos, '%');
+        if (!percent)
+        {
+            out.append(pos);
+            return;
+        }
+        out.append(pos, static_cast<size_t>(percent - pos));
+
+        if (percent[1] == '%')
+        {
+            out.push_back('%');
+            pos = percent + 2;
+            continue;
+        }
+
+        // Copies flags, width and precision into spec, '*' is replaced by the int argument.
+        // Repeated flags are copied once, so the spec has a fixed maximum length.
+        char spec[SPEC_CAPACITY] = "%";
+        size_t specLen = 1;
+        const char* cur = percent + 1;
+        bool isMissingArg = false;
+        bool isTooLong = false;
+        auto copyNumber = [&]() {
+            if (*cur == '*')
+            {
+                eLogArgType type;
+                if (!reader.next(type))
+                    isMissingArg = true;
+                else if (type == eLogArgType::Int)
+                    specLen += static_cast<size_t>(std::snprintf(spec + specLen, 12, "%d", reader.read<int>()));
+                else
+                {
+                    reader.skip(type);
+                    isMissingArg = true;
+                }
+                ++cur;
+                return;
+            }
+            for (size_t digits = 0; *cur >= '0' && *cur <= '9'; ++digits, ++cur)
+            {
+                if (digits < MAX_SPEC_DIGITS)
+                    spec[specLen++] = *cur;
+                else
+                    isTooLong = true;
+            }
+        };
+
+        for (; *cur && std::strchr("-+ #0'", *cur); ++cur)
+        {
+            if (!std::memchr(spec + 1, *cur, specLen - 1))
+                spec[specLen++] = *cur;
+        }
+        copyNumber();
+        if (*cur == '.')
+        {
+            spec[specLen++] = *cur++;
+            copyNumber();
+        }
+        while (*cur && std::strchr("hljztLq", *cur))
+            ++cur;
+
+        const char conv = *cur;
+        if (!conv)
+        {
+            out.append(percent);
+            return;
+        }
+        pos = cur + 1;
+
+        eLogArgType type;
+        if (conv == 'n')
+        {
+            if (reader.next(type))
+                reader.skip(type);
+            continue;
+        }
+        if (isTooLong)
+        {
+            // Printed as it is, like a spec without its argument, but the argument is used up.
+            if (reader.next(type))
+                reader.skip(type);
+            out.append(percent, static_cast<size_t>(pos - percent));
+            continue;
+        }
+        if (isMissingArg || !reader.next(type))
+        {
+            out.append(percent, static_cast<size_t>(pos - percent));
+            continue;
+        }
+        AppendArg(out, spec, specLen, conv, type, reader);
+    }
+}
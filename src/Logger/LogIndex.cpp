@@ -0,0 +1,104 @@
+#include "LogIndex.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+#define INDEX_SIGNATURE "SLIX"
+#define INDEX_SIGNATURE_LENGTH 4
+#define INDEX_VERSION 1
+#define INDEX_HEADER_SIZE 16
+
+    // Signature, version, block size, reserved.
+    void WriteHeader(std::FILE* file, uint64_t blockSize)
+    {
+        char header[INDEX_HEADER_SIZE] = {};
+        std::memcpy(header, INDEX_SIGNATURE, INDEX_SIGNATURE_LENGTH);
+        const uint32_t version = INDEX_VERSION;
+        const auto size = static_cast<uint32_t>(std::min<uint64_t>(blockSize, UINT32_MAX));
+        std::memcpy(header + 4, &version, sizeof(version));
+        std::memcpy(header + 8, &size, sizeof(size));
+        std::fwrite(header, 1, sizeof(header), file);
+    }
+}
+
+std::string LogIndexPath(const std::string& logPath)
+{
+    return logPath + LogIndexExtension;
+}
+
+sLogIndexWriter::sLogIndexWriter(const std::string& logPath, uint64_t blockSize, uint64_t logSize)
+    : m_blockSize(blockSize)
+{
+    const std::string path = LogIndexPath(logPath);
+    m_file = std::fopen(path.c_str(), logSize == 0 ? "wb" : "ab");
+    if (m_file)
+        std::fseek(m_file, 0, SEEK_END);
+    if (m_file && std::ftell(m_file) == 0)
+        WriteHeader(m_file, blockSize);
+}
+
+sLogIndexWriter::~sLogIndexWriter()
+{
+    if (!m_file)
+        return;
+    if (m_block.m_size > 0)
+        writeEntry();
+    std::fclose(m_file);
+}
+
+void sLogIndexWriter::add(const sLogRecord& record, uint64_t offset, size_t size)
+{
+    if (!m_file)
+        return;
+
+    sLogIndexEntry& block = m_block;
+    if (block.m_size == 0)
+        block.m_offset = offset;
+    else if (offset != block.m_offset + block.m_size)
+    {
+        // Something else wrote to the file, the block ends at the last known record.
+        writeEntry();
+        block.m_offset = offset;
+    }
+    block.m_size += size;
+    if (record.m_time != 0)
+    {
+        block.m_minTime = block.m_minTime == 0 ? record.m_time : std::min(block.m_minTime, record.m_time);
+        block.m_maxTime = std::max(block.m_maxTime, record.m_time);
+    }
+    block.m_threads |= uint64_t(1) << (record.m_threadIndex % 64);
+    block.m_levels |= static_cast<uint8_t>(1u << static_cast<unsigned>(record.m_type));
+    if (block.m_size >= m_blockSize)
+        writeEntry();
+}
+
+void sLogIndexWriter::flush()
+{
+    if (m_file)
+        std::fflush(m_file);
+}
+
+void sLogIndexWriter::writeEntry()
+{
+    std::fwrite(&m_block, sizeof(m_block), 1, m_file);
+    m_block = sLogIndexEntry();
+}
+
+bool ReadLogIndex(const char* data, size_t size, std::vector<sLogIndexEntry>& entries)
+{
+    entries.clear();
+    if (size < INDEX_HEADER_SIZE || std::memcmp(data, INDEX_SIGNATURE, INDEX_SIGNATURE_LENGTH) != 0)
+        return false;
+    uint32_t version = 0;
+    std::memcpy(&version, data + 4, sizeof(version));
+    if (version != INDEX_VERSION)
+        return false;
+
+    const size_t count = (size - INDEX_HEADER_SIZE) / sizeof(sLogIndexEntry);
+    entries.resize(count);
+    std::memcpy(entries.data(), data + INDEX_HEADER_SIZE, count * sizeof(sLogIndexEntry));
+    return true;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file LogIndex.h
+ * @brief Sparse sidecar index of a text log file, written by the logger and read by logsearch.
+ *
+ * The index of "app.log" is "app.log.idx": a header followed by fixed-size entries, one per
+ * block of about the block size of the log. A block starts and ends at record boundaries.
+ * Entries are appended when their block is complete and when the log is closed, so a block
+ * that lost its entry in a crash is simply not indexed and must be scanned.
+ */
+
+#pragma once
+
+#include "LogRecord.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Extension appended to the path of the log.
+ */
+inline constexpr char LogIndexExtension[] = ".idx";
+
+/**
+ * @brief A block of the log file.
+ */
+struct sLogIndexEntry
+{
+    uint64_t m_offset = 0;      //!< Start of the block in the log file
+    uint64_t m_size = 0;        //!< Length of the block
+    int64_t m_minTime = 0;      //!< Earliest record time, microseconds since the Unix epoch, 0 if the records have none
+    int64_t m_maxTime = 0;      //!< Latest record time
+    uint64_t m_threads = 0;     //!< Bit (thread index % 64) for every thread with a record in the block
+    uint8_t m_levels = 0;       //!< Bit (numeric value of eLogMsgType) for every record type in the block
+    uint8_t m_reserved[7] = {};
+};
+
+static_assert(sizeof(sLogIndexEntry) == 48, "the index entries are stored as they are in memory");
+
+/**
+ * @brief Returns the path of the index of the log file.
+ */
+std::string LogIndexPath(const std::string& logPath);
+
+/**
+ * @brief Appends the entries of a log file to its index.
+ */
+struct sLogIndexWriter
+{
+    /**
+     * @param logSize Current length of the log. An empty log starts a new index, otherwise
+     * the entries are appended to the existing one.
+     */
+    sLogIndexWriter(const std::string& logPath, uint64_t blockSize, uint64_t logSize);
+
+    /**
+     * @brief Writes the entry of the unfinished block.
+     */
+    ~sLogIndexWriter();
+
+    sLogIndexWriter(const sLogIndexWriter&) = delete;
+    sLogIndexWriter& operator=(const sLogIndexWriter&) = delete;
+
+    /**
+     * @brief Adds a record written at the offset of the log.
+     */
+    void add(const sLogRecord& record, uint64_t offset, size_t size);
+
+    /**
+     * @brief Hands the written entries over to the operating system.
+     */
+    void flush();
+
+private:
+    void writeEntry();
+
+    std::FILE* m_file = nullptr;
+    uint64_t m_blockSize;
+    sLogIndexEntry m_block;
+};
+
+/**
+ * @brief Reads the entries of an index held in memory.
+ * @return false if the data is not an index. A truncated last entry is ignored.
+ */
+bool ReadLogIndex(const char* data, size_t size, std::vector<sLogIndexEntry>& entries);
@@ -0,0 +1,52 @@
+#include "LogRateLimit.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    int64_t SteadyNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+sLogRateLimiter::sLogRateLimiter(double perSecond, unsigned burst)
+    : m_intervalNs(static_cast<int64_t>(1e9 / std::max(perSecond, 1e-9)))
+    , m_toleranceNs(m_intervalNs * (static_cast<int64_t>(std::max(burst, 1u)) - 1))
+{
+}
+
+bool sLogRateLimiter::tryPass(uint64_t& suppressed)
+{
+    const int64_t now = SteadyNanoseconds();
+    int64_t fullAt = m_fullAtNs.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        const int64_t from = std::max(fullAt, now);
+        if (from - now > m_toleranceNs)
+        {
+            m_suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (m_fullAtNs.compare_exchange_weak(fullAt, from + m_intervalNs, std::memory_order_relaxed))
+            break;
+    }
+    suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+sLogSampler::sLogSampler(uint64_t everyN)
+    : m_everyN(std::max<uint64_t>(everyN, 1))
+{
+}
+
+bool sLogSampler::tryPass(uint64_t& suppressed)
+{
+    const uint64_t call = m_calls.fetch_add(1, std::memory_order_relaxed);
+    if (call % m_everyN != 0)
+        return false;
+    suppressed = call == 0 ? 0 : m_everyN - 1;
+    return true;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file LogRecord.h
+ * @brief Internal representation of a single log record.
+ */
+
+#pragma once
+
+#include "Logger.h"
+#include "LogArgs.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+enum class ePrintColor : uint8_t
+{
+    Blue = 1,
+    Green = 2,
+    Cyan = 3,
+    Red = 4,
+    Magenta = 5,
+    Yellow = 6,
+    White = 7
+};
+
+/**
+ * @brief A finished log record ready to be written to the outputs.
+ * @note The colored variant (for terminals) and the plain variant (for files) are
+ * assembled in the same pass, so every output receives the record in a single write.
+ * Records are reused: clear() keeps the allocated capacity.
+ * A record with deferred formatting carries the format string and the captured arguments
+ * instead of the message text; resolve() formats them on the thread that writes the record.
+ * The binary file format stores the format string and the arguments as well, together with
+ * the fields of the prefix, instead of the text.
+ */
+struct sLogRecord
+{
+    std::string m_colored;            //!< Text with ANSI color escape codes.
+    std::string m_plain;              //!< Text without escape codes.
+    const char* m_format = nullptr;   //!< Format of the captured arguments if it outlives the record, see format().
+    std::string m_ownFormat;          //!< Copy of a format that may be gone before the record is written.
+    bool m_hasOwnFormat = false;      //!< The format is m_ownFormat instead of m_format.
+    std::string m_args;               //!< Arguments captured by EncodeLogArgs for the format.
+    bool m_isDeferred = false;        //!< The message text is still to be formatted by resolve().
+    eLogMsgType m_type = eLogMsgType::None;
+    bool m_hasThreadTag = false;      //!< The prefix shows the thread.
+    size_t m_messageOffset = 0;       //!< Length of the prefix in m_plain.
+    int64_t m_time = 0;               //!< Microseconds since the Unix epoch, set with timestamps, the binary format, the file index and the shared ring.
+    uint32_t m_threadIndex = 0;       //!< Index of the logging thread, set for the binary format and the file index.
+
+    void clear()
+    {
+        m_colored.clear();
+        m_plain.clear();
+        m_format = nullptr;
+        m_hasOwnFormat = false;
+        m_args.clear();
+        m_isDeferred = false;
+        m_type = eLogMsgType::None;
+        m_time = 0;
+        m_hasThreadTag = false;
+        m_messageOffset = 0;
+    }
+
+    /**
+     * @brief Stores the format of the captured arguments.
+     * @param isCopied Whether the text is copied, for a format that may not outlive the record.
+     */
+    void setFormat(const char* format, bool isCopied)
+    {
+        m_hasOwnFormat = isCopied;
+        if (isCopied)
+            m_ownFormat.assign(format);
+        else
+            m_format = format;
+    }
+
+    bool hasFormat() const
+    {
+        return m_hasOwnFormat || m_format != nullptr;
+    }
+
+    const char* format() const
+    {
+        return m_hasOwnFormat ? m_ownFormat.c_str() : m_format;
+    }
+
+    /**
+     * @brief Appends the formatted message and the line break of a deferred record.
+     */
+    void resolve()
+    {
+        if (!m_isDeferred)
+            return;
+        appendFormatted(format(), m_args);
+        append("\n", 1);
+        m_isDeferred = false;
+    }
+
+    /**
+     * @brief Formats the captured arguments straight into both variants.
+     */
+    void appendFormatted(const char* format, const std::string& args)
+    {
+        const size_t from = m_plain.size();
+        FormatLogArgs(format, args.data(), args.size(), m_plain);
+        m_colored.append(m_plain, from, std::string::npos);
+    }
+
+    /**
+     * @brief Runs an encoder that appends to the plain text, then copies its output to the colored text.
+     */
+    template <typename Encode>
+    void appendEncoded(Encode&& encode)
+    {
+        const size_t from = m_plain.size();
+        encode(m_plain);
+        m_colored.append(m_plain, from, std::string::npos);
+    }
+
+    void append(const char* text, size_t size)
+    {
+        m_colored.append(text, size);
+        m_plain.append(text, size);
+    }
+
+    void append(const char* text)
+    {
+        append(text, std::strlen(text));
+    }
+
+    void append(const std::string& text)
+    {
+        append(text.data(), text.size());
+    }
+
+    void beginColor(ePrintColor color)
+    {
+        switch (color)
+        {
+        case ePrintColor::Blue:    m_colored.append("\033[0;34m"); break;
+        case ePrintColor::Green:   m_colored.append("\033[0;32m"); break;
+        case ePrintColor::Cyan:    m_colored.append("\033[0;36m"); break;
+        case ePrintColor::Red:     m_colored.append("\033[0;31m"); break;
+        case ePrintColor::Magenta: m_colored.append("\033[0;35m"); break;
+        case ePrintColor::Yellow:  m_colored.append("\033[0;33m"); break;
+        case ePrintColor::White:   m_colored.append("\033[0;37m"); break;
+        }
+    }
+
+    void endColor()
+    {
+        m_colored.append("\033[0m");
+    }
+
+    /**
+     * @brief Appends a colored tag such as "[Info]".
+     */
+    void appendTag(ePrintColor color, const char* tag)
+    {
+        beginColor(color);
+        append(tag);
+        endColor();
+    }
+};
@@ -1,34 +1,50 @@
 #include "Logger.h"
+#include "AsyncWriter.h"
+#include "BinaryLog.h"
+#include "FastClock.h"
+#include "FlightRecorder.h"
+#include "FileSinks.h"
+#include "LogArchiver.h"
+#include "LogIndex.h"
+#include "LogRecord.h"
+#include "MemoryUsage.h"
+#include "PeriodicTask.h"
+#include "SharedRing.h"
+#include "StructuredLog.h"
+#include "Telemetry.h"
+#include "ThreadFiles.h"
+#include "TimerStats.h"
 
+#include <algorithm>
 #include <climits>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
-#include <fstream>
 #include <sstream>
+#include <vector>
 
 namespace
 {
-#define FAILED_TIME_MEASUREMENT -1
+#define DEFAULT_ASYNC_QUEUE_CAPACITY 8192
+#define TIMESTAMP_LENGTH 27
+#define LOGGER_OFF_THRESHOLD 0xFF
 
-    enum class ePrintColor : uint8_t
-    {
-        Blue = 1,
-        Green = 2,
-        Cyan = 3,
-        Red = 4,
-        Magenta = 5,
-        Yellow = 6,
-        White = 7
-    };
 #ifdef _WIN32
     #include <windows.h>
 
-    void PrintInColor(ePrintColor color, const std::string& line, std::ostream& out, bool isCerr = true)
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+    #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+    bool EnableColors(bool isCerr)
     {
         HANDLE outputHandle = GetStdHandle(isCerr ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE);
-        SetConsoleTextAttribute(outputHandle, static_cast<uint8_t>(color));
-        out << line;
-        SetConsoleTextAttribute(outputHandle, static_cast<uint8_t>(ePrintColor::White));
+        DWORD mode = 0;
+        if (outputHandle == INVALID_HANDLE_VALUE || !GetConsoleMode(outputHandle, &mode))
+            return false;
+        return SetConsoleMode(outputHandle, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
     }
 
     std::string GetProcessID()
@@ -38,20 +54,9 @@ namespace
 #else
     #include <unistd.h>
 
-    void PrintInColor(ePrintColor color, const std::string& line, std::ostream& out, bool dummy = true)
+    bool EnableColors(bool)
     {
-        if (color == ePrintColor::Blue)
-            out << "\033[0;34m" << line << "\033[0m";
-        else if (color == ePrintColor::Green)
-            out << "\033[0;32m" << line << "\033[0m";
-        else if (color == ePrintColor::Cyan)
-            out << "\033[0;36m" << line << "\033[0m";
-        else if (color == ePrintColor::Red)
-            out << "\033[0;31m" << line << "\033[0m";
-        else if (color == ePrintColor::Magenta)
-            out << "\033[0;35m" << line << "\033[0m";
-        else if (color == ePrintColor::Yellow)
-            out << "\033[0;33m" << line << "\033[0m";
+        return true;
     }
 
     std::string GetProcessID()
@@ -59,69 +64,328 @@ namespace
         return std::to_string(getpid());
     }
 #endif
-}
 
-struct sTime
-{
-    std::chrono::time_point<std::chrono::steady_clock> m_start;
+    // Reused by every record of the thread, so building a record does not allocate
+    // once the buffers have grown to the usual record size.
+    thread_local sLogRecord t_record;
+    thread_local std::string t_argsBuffer;
+    thread_local std::string t_textBuffer;
+    thread_local std::string t_messageBuffer;
+    thread_local std::string t_objectBuffer;
+
+    sLogRecord& NewRecord()
+    {
+        t_record.clear();
+        return t_record;
+    }
+
+    struct sTimerFrame
+    {
+        uint64_t m_startTicks = 0;  //!< ClockTicks reading, converted to units only when the timer stops
+        std::string m_name;
+    };
+
+    // Running timers of the thread, innermost last. Frames past m_depth are kept, so their
+    // names reuse the string capacity and starting a timer does not allocate.
+    struct sTimerStack
+    {
+        std::vector<sTimerFrame> m_frames;
+        size_t m_depth = 0;
+    };
+
+    thread_local sTimerStack t_timers;
+
+    struct sMemoryFrame
+    {
+        sLogMemoryUsage m_start;
+        std::string m_name;
+    };
+
+    // Running memory regions of the thread, kept like the timer frames.
+    struct sMemoryStack
+    {
+        std::vector<sMemoryFrame> m_frames;
+        size_t m_depth = 0;
+    };
+
+    thread_local sMemoryStack t_memoryRegions;
 
-    void start()
+    long long KibibytesDelta(uint64_t now, uint64_t before)
     {
-        m_start = std::chrono::steady_clock::now();
+        return (static_cast<long long>(now) - static_cast<long long>(before)) / 1024;
     }
 
-    long long stopSeconds()
+    long long ElapsedIn(eLogTimerUnits units, uint64_t elapsedNs)
     {
-        auto end = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::seconds>(end - m_start).count();
+        const auto elapsed = static_cast<long long>(elapsedNs);
+        if (units == eLogTimerUnits::Seconds)
+            return elapsed / 1000000000;
+        if (units == eLogTimerUnits::Milliseconds)
+            return elapsed / 1000000;
+        if (units == eLogTimerUnits::Microseconds)
+            return elapsed / 1000;
+        return elapsed;
     }
 
-    long long stopMilliseconds()
+    // Names of the threads that logged, by thread index.
+    // Never destroyed, the writer may still need it while static objects are destroyed.
+    struct sThreadRegistry
     {
-        auto end = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(end - m_start).count();
+        std::mutex m_mtx;
+        std::vector<std::string> m_names;
+    };
+
+    sThreadRegistry& ThreadRegistry()
+    {
+        static sThreadRegistry* registry = new sThreadRegistry;
+        return *registry;
+    }
+
+    // Index and "[thread name]" tag of a thread, formatted when the thread first logs and
+    // again only when it is renamed.
+    struct sThreadInfo
+    {
+        uint32_t m_index = 0;
+        std::string m_name;
+        std::string m_tag;
+    };
+
+    std::string ThreadTag(std::string_view name)
+    {
+        std::string tag = "[thread ";
+        tag.append(name.data(), name.size());
+        tag += ']';
+        return tag;
     }
 
-    long long stopMicroseconds()
+    sThreadInfo RegisterCurrentThread()
     {
-        auto end = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - m_start).count();
+        std::ostringstream ss;
+        ss << std::this_thread::get_id();
+        sThreadInfo info;
+        info.m_name = ss.str();
+        info.m_tag = ThreadTag(info.m_name);
+
+        sThreadRegistry& registry = ThreadRegistry();
+        std::lock_guard<std::mutex> lock(registry.m_mtx);
+        registry.m_names.push_back(ss.str());
+        info.m_index = static_cast<uint32_t>(registry.m_names.size() - 1);
+        return info;
     }
 
-    long long stopNanoseconds()
+    sThreadInfo& CurrentThread()
     {
-        auto end = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
+        thread_local sThreadInfo info = RegisterCurrentThread();
+        return info;
     }
-};
+
+    std::string ThreadName(uint32_t index)
+    {
+        sThreadRegistry& registry = ThreadRegistry();
+        std::lock_guard<std::mutex> lock(registry.m_mtx);
+        return index < registry.m_names.size() ? registry.m_names[index] : std::to_string(index);
+    }
+
+    void AppendDigits(char* out, unsigned value, int count)
+    {
+        for (int i = count - 1; i >= 0; --i)
+        {
+            out[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    // "YYYY-MM-DD HH:MM:SS." of the last second a thread logged in, so the date is
+    // formatted once per second and only the microseconds once per record.
+    struct sTimestampCache
+    {
+        int64_t m_second = INT64_MIN;
+        char m_text[TIMESTAMP_LENGTH + 1] = {};
+    };
+
+    thread_local sTimestampCache t_timestamp;
+
+    // Returns "YYYY-MM-DD HH:MM:SS.uuuuuu " of the time, TIMESTAMP_LENGTH characters.
+    const char* TimestampText(int64_t microseconds)
+    {
+        int64_t second = microseconds / 1000000;
+        int64_t fraction = microseconds % 1000000;
+        if (fraction < 0)
+        {
+            fraction += 1000000;
+            --second;
+        }
+
+        sTimestampCache& cache = t_timestamp;
+        if (cache.m_second != second)
+        {
+            const auto seconds = static_cast<std::time_t>(second);
+            std::tm local = {};
+#ifdef _WIN32
+            localtime_s(&local, &seconds);
+#else
+            localtime_r(&seconds, &local);
+#endif
+            char* text = cache.m_text;
+            AppendDigits(text, static_cast<unsigned>(local.tm_year + 1900), 4);
+            text[4] = '-';
+            AppendDigits(text + 5, static_cast<unsigned>(local.tm_mon + 1), 2);
+            text[7] = '-';
+            AppendDigits(text + 8, static_cast<unsigned>(local.tm_mday), 2);
+            text[10] = ' ';
+            AppendDigits(text + 11, static_cast<unsigned>(local.tm_hour), 2);
+            text[13] = ':';
+            AppendDigits(text + 14, static_cast<unsigned>(local.tm_min), 2);
+            text[16] = ':';
+            AppendDigits(text + 17, static_cast<unsigned>(local.tm_sec), 2);
+            text[19] = '.';
+            text[26] = ' ';
+            cache.m_second = second;
+        }
+        AppendDigits(cache.m_text + 20, static_cast<unsigned>(fraction), 6);
+        return cache.m_text;
+    }
+
+    const char* LevelName(eLogMsgType type)
+    {
+        static const char* const names[] = { "", "trace", "debug", "info", "warning", "error" };
+        return names[static_cast<size_t>(type)];
+    }
+
+    const char* UnitsName(eLogTimerUnits units)
+    {
+        if (units == eLogTimerUnits::Seconds)
+            return "sec";
+        if (units == eLogTimerUnits::Milliseconds)
+            return "millisec";
+        if (units == eLogTimerUnits::Microseconds)
+            return "microsec";
+        return "nanosec";
+    }
+
+    // "name: message", or whichever of the two is given.
+    void AppendTimerMessage(std::string& out, std::string_view name, std::string_view msg)
+    {
+        out.append(name.data(), name.size());
+        if (!name.empty() && !msg.empty() && msg != name)
+            out.append(": ", 2);
+        if (msg != name)
+            out.append(msg.data(), msg.size());
+    }
+}
 
 struct sOutputManager
 {
     bool m_isCout = true;
     bool m_isCerr = false;
     bool m_isFile = false;
-    bool m_openCloseFileOnWrite = false;
+    bool m_coutColors = EnableColors(false);
+    bool m_cerrColors = EnableColors(true);
+    eFileSinkKind m_fileKind = eFileSinkKind::Stream;
     std::string m_filePath;
-    std::ofstream m_file;
+    std::unique_ptr<sFileSink> m_upFile;
+    eLogDurability m_durability = eLogDurability::None;
+    unsigned m_durabilityValue = 0;
+    unsigned m_uncommittedRecords = 0;
+    std::chrono::steady_clock::time_point m_lastCommit;
+    uint64_t m_maxFileSize = 0;
+    std::chrono::seconds m_rotationInterval{ 0 };
+    std::chrono::steady_clock::time_point m_fileOpenedAt;
+    std::unique_ptr<sLogArchiver> m_upArchiver;
+    bool m_isBinary = false;
+    sBinaryLogEncoder m_encoder{ &ThreadName };
+    bool m_perThreadFiles = false;
+    std::string m_binaryBuffer;
+    uint64_t m_indexBlockSize = 0;
+    std::unique_ptr<sLogIndexWriter> m_upIndex;
+    std::unique_ptr<sSharedRingWriter> m_upRing;
 
-    void print(const std::string& msg)
+    void write(sLogRecord& record)
     {
+        // The binary format only needs the format and the arguments of a deferred record.
+        if (m_isCout || m_isCerr || (m_isFile && !m_isBinary) || m_upRing)
+            record.resolve();
+
         if (m_isCout)
-            std::cout << msg;
+        {
+            const std::string& text = m_coutColors ? record.m_colored : record.m_plain;
+            writeTo(std::cout, text);
+            CountTelemetry(eTelemetryCounter::CoutBytes, text.size());
+        }
         if (m_isCerr)
-            std::cerr << msg;
-        if (m_isFile)
-            printToFile(msg);
+        {
+            const std::string& text = m_cerrColors ? record.m_colored : record.m_plain;
+            writeTo(std::cerr, text);
+            CountTelemetry(eTelemetryCounter::CerrBytes, text.size());
+        }
+        if (m_upRing && !m_upRing->write(record.m_time, record.m_type, record.m_plain))
+            CountTelemetry(eTelemetryCounter::Dropped);
+        if (m_isFile && !m_perThreadFiles)
+        {
+            printToFile(record);
+            commitIfDue(record.m_type);
+            if (m_maxFileSize > 0 && m_upFile && m_upFile->size() >= m_maxFileSize)
+                rotate();
+        }
+    }
+
+    void onIdle()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (m_durability == eLogDurability::Interval && m_uncommittedRecords > 0
+            && now - m_lastCommit >= std::chrono::milliseconds(m_durabilityValue))
+            commit();
+
+        if (m_rotationInterval.count() > 0 && now - m_fileOpenedAt >= m_rotationInterval)
+        {
+            // An empty file is kept and its age starts over.
+            if (m_upFile && m_upFile->size() > 0)
+                rotate();
+            else
+                m_fileOpenedAt = now;
+        }
+    }
+
+    // Period of the periodic work the settings need, zero if there is none.
+    std::chrono::milliseconds housekeepingPeriod() const
+    {
+        std::chrono::milliseconds period(0);
+        if (m_durability == eLogDurability::Interval)
+            period = std::chrono::milliseconds(m_durabilityValue);
+        if (m_rotationInterval.count() > 0)
+        {
+            const std::chrono::milliseconds check = std::min<std::chrono::milliseconds>(m_rotationInterval, std::chrono::seconds(1));
+            period = period.count() > 0 ? std::min(period, check) : check;
+        }
+        return period;
+    }
+
+    void commit()
+    {
+        if (m_upFile)
+        {
+            m_upFile->sync();
+            CountTelemetry(eTelemetryCounter::FileSyncs);
+        }
+        m_uncommittedRecords = 0;
+        m_lastCommit = std::chrono::steady_clock::now();
     }
 
-    void colorPrint(ePrintColor color, const std::string& msg)
+    void flush()
     {
         if (m_isCout)
-            PrintInColor(color, msg, std::cout, false);
+            std::cout.flush();
         if (m_isCerr)
-            PrintInColor(color, msg, std::cout);
-        if (m_isFile)
-            printToFile(msg);
+            std::cerr.flush();
+        if (m_upFile)
+            m_upFile->flush();
+        if (m_upIndex)
+            m_upIndex->flush();
+    }
+
+    bool hasOutputs() const
+    {
+        return m_isCout || m_isCerr || (m_isFile && !m_perThreadFiles) || m_upRing != nullptr;
     }
 
     void resetFlags()
@@ -129,62 +393,243 @@ struct sOutputManager
         m_isCout = false;
         m_isCerr = false;
         m_isFile = false;
-        m_openCloseFileOnWrite = false;
+    }
+
+    void setFileKind(eFileSinkKind kind)
+    {
+        if (kind == m_fileKind)
+            return;
+        // The file is reopened with the new strategy on the next write.
+        closeSink();
+        m_fileKind = kind;
+    }
+
+    void setBinary(bool isBinary)
+    {
+        // Switching to the binary format starts a new session in the file.
+        if (isBinary != m_isBinary)
+            m_encoder.reset();
+        m_isBinary = isBinary;
+    }
+
+    void setPerThreadFiles(bool isPerThread)
+    {
+        // The shared file stays closed while every thread writes its own.
+        m_perThreadFiles = isPerThread;
+        if (isPerThread)
+            closeSink();
+        ConfigureThreadFiles(isPerThread ? m_filePath : std::string(), m_fileKind, m_isBinary, &ThreadName);
+    }
+
+    void setIndex(uint64_t blockSize)
+    {
+        m_upIndex.reset();
+        m_indexBlockSize = blockSize;
+        if (m_upFile)
+            openIndex();
+    }
+
+    void openFile(const std::string& path)
+    {
+        closeSink();
+        m_filePath = path;
+        if (m_perThreadFiles)
+            ConfigureThreadFiles(m_filePath, m_fileKind, m_isBinary, &ThreadName);
+        else
+            openSink();
+        m_fileOpenedAt = std::chrono::steady_clock::now();
     }
 
 private:
-    void printToFile(const std::string& value)
+    void rotate()
+    {
+        if (m_durability != eLogDurability::None)
+            commit();
+        // Closing the sink writes out its buffer (or truncates the mapped file) before the rename.
+        const bool isIndexed = m_upIndex != nullptr;
+        closeSink();
+        const std::string segmentPath = NextLogSegmentPath(m_filePath);
+        if (std::rename(m_filePath.c_str(), segmentPath.c_str()) == 0)
+        {
+            if (isIndexed)
+                std::rename(LogIndexPath(m_filePath).c_str(), LogIndexPath(segmentPath).c_str());
+            if (m_upArchiver)
+                m_upArchiver->add(segmentPath, m_filePath);
+        }
+        openSink();
+        m_fileOpenedAt = std::chrono::steady_clock::now();
+    }
+
+    void commitIfDue(eLogMsgType type)
+    {
+        ++m_uncommittedRecords;
+        if (m_durability == eLogDurability::EveryNRecords && m_uncommittedRecords >= m_durabilityValue)
+            commit();
+        else if (m_durability == eLogDurability::OnError && type == eLogMsgType::Error)
+            commit();
+    }
+
+    static void writeTo(std::ostream& out, const std::string& text)
+    {
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    void openSink()
+    {
+        m_upFile = CreateFileSink(m_fileKind, m_filePath);
+        // Every opened binary file starts with a header and its own formats and threads.
+        m_encoder.reset();
+        openIndex();
+    }
+
+    void openIndex()
     {
-        if (!m_file.is_open())
-            m_file.open(m_filePath, std::ios_base::app);
+        m_upIndex.reset();
+        if (m_upFile && m_indexBlockSize > 0 && !m_isBinary)
+            m_upIndex = std::make_unique<sLogIndexWriter>(m_filePath, m_indexBlockSize, m_upFile->size());
+    }
 
-        if (m_openCloseFileOnWrite)
+    void closeSink()
+    {
+        m_upIndex.reset();
+        m_upFile.reset();
+    }
+
+    void printToFile(const sLogRecord& record)
+    {
+        if (!m_upFile)
+            openSink();
+        if (!m_upFile)
+            return;
+
+        const std::string* text = &record.m_plain;
+        if (m_isBinary)
         {
-            m_file << value;
-            m_file.close();
+            m_binaryBuffer.clear();
+            m_encoder.encode(record, m_binaryBuffer);
+            text = &m_binaryBuffer;
         }
-        else
-            m_file << value;
+        // The index entry needs the offset of the record, before the write moves it.
+        if (m_upIndex && !m_isBinary)
+            m_upIndex->add(record, m_upFile->size(), text->size());
+        if (!IsTelemetryOn())
+        {
+            m_upFile->write(text->data(), text->size());
+            return;
+        }
+
+        const uint64_t start = ClockTicks();
+        m_upFile->write(text->data(), text->size());
+        CountTelemetry(eTelemetryCounter::FileWriteNs, ElapsedNanoseconds(start, ClockTicks()));
+        CountTelemetry(eTelemetryCounter::FileWrites);
+        CountTelemetry(eTelemetryCounter::FileBytes, text->size());
     }
 };
 
-std::unordered_map<std::thread::id, std::unique_ptr<sTime>> Logger::m_upThreadsTimers;
 std::unique_ptr<sOutputManager> Logger::m_upOutputter = std::make_unique<sOutputManager>();
 bool Logger::m_useThreadID = false;
-bool Logger::m_isOn = true;
+bool Logger::m_showTimestamp = false;
+std::atomic<uint8_t> Logger::m_threshold{ Logger::severity(eLogMsgType::Trace) };
+eLogMsgType Logger::m_minLevel = eLogMsgType::Trace;
+bool Logger::m_deferFormatting = false;
+bool Logger::m_binaryFile = false;
+bool Logger::m_perThreadFiles = false;
+bool Logger::m_indexedFile = false;
+bool Logger::m_sharedRing = false;
+eLogLayout Logger::m_layout = eLogLayout::Text;
 std::mutex Logger::m_mtx;
+// Defined after the outputter so it is destroyed (and drained) first.
+std::unique_ptr<sAsyncWriter> Logger::m_upAsyncWriter;
+size_t Logger::m_asyncQueueCapacity = DEFAULT_ASYNC_QUEUE_CAPACITY;
+eLogBackpressure Logger::m_asyncBackpressure = eLogBackpressure::Block;
+unsigned long long Logger::m_droppedRecords = 0;
+std::atomic<sFlightRecorder*> Logger::m_flightRecorder{ nullptr };
+std::atomic<unsigned> Logger::m_flightRecorderUsers{ 0 };
+// Defined last so it is stopped before anything it touches is destroyed.
+std::unique_ptr<sPeriodicTask> Logger::m_upHousekeeper;
+std::atomic<bool> Logger::m_aggregateTimers{ false };
+std::unique_ptr<sPeriodicTask> Logger::m_upTimerReporter;
+std::unique_ptr<sPeriodicTask> Logger::m_upMemorySampler;
+std::unique_ptr<sPeriodicTask> Logger::m_upTelemetryReporter;
 
 void Logger::turnOff()
 {
-    m_isOn = false;
+    m_threshold.store(LOGGER_OFF_THRESHOLD, std::memory_order_relaxed);
 }
 
 void Logger::turnOn()
 {
-    m_isOn = true;
+    m_threshold.store(severity(m_minLevel), std::memory_order_relaxed);
+}
+
+void Logger::setLogLevel(eLogMsgType minLevel)
+{
+    m_minLevel = minLevel == eLogMsgType::None ? eLogMsgType::Trace : minLevel;
+    if (m_threshold.load(std::memory_order_relaxed) != LOGGER_OFF_THRESHOLD)
+        m_threshold.store(severity(m_minLevel), std::memory_order_relaxed);
+}
+
+eLogMsgType Logger::getLogLevel()
+{
+    return m_minLevel;
 }
 
 void Logger::adjustSettings(int settingsFlags)
 {
-    m_upOutputter->resetFlags();
-    m_useThreadID = false;
+    resetAsyncWriter(false);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_upOutputter->resetFlags();
+        m_useThreadID = false;
+        m_showTimestamp = false;
+        m_deferFormatting = false;
+        m_binaryFile = false;
+        m_perThreadFiles = false;
 
-    if (settingsFlags & eLogSettings::UseCout)
-        m_upOutputter->m_isCout = true;
-    if (settingsFlags & eLogSettings::UseCerr)
-        m_upOutputter->m_isCerr = true;
-    if (settingsFlags & eLogSettings::UseFile)
-        m_upOutputter->m_isFile = true;
-    if (settingsFlags & eLogSettings::OpenCloseFile)
-        m_upOutputter->m_openCloseFileOnWrite = true;
-    if (settingsFlags & eLogSettings::ShowThreadID)
-        m_useThreadID = true;
+        if (settingsFlags & eLogSettings::UseCout)
+            m_upOutputter->m_isCout = true;
+        if (settingsFlags & eLogSettings::UseCerr)
+            m_upOutputter->m_isCerr = true;
+        if (settingsFlags & eLogSettings::UseFile)
+            m_upOutputter->m_isFile = true;
+        if (settingsFlags & eLogSettings::MappedFile)
+            m_upOutputter->setFileKind(eFileSinkKind::Mapped);
+        else if (settingsFlags & eLogSettings::OpenCloseFile)
+            m_upOutputter->setFileKind(eFileSinkKind::OpenClose);
+        else
+            m_upOutputter->setFileKind(eFileSinkKind::Stream);
+        if (settingsFlags & eLogSettings::ShowThreadID)
+            m_useThreadID = true;
+        if (settingsFlags & eLogSettings::ShowTimestamp)
+            m_showTimestamp = true;
+        if (settingsFlags & eLogSettings::DeferredFormat)
+            m_deferFormatting = true;
+        if ((settingsFlags & eLogSettings::BinaryFile) && (settingsFlags & eLogSettings::UseFile))
+            m_binaryFile = true;
+        m_upOutputter->setBinary(m_binaryFile);
+        m_layout = eLogLayout::Text;
+        if (!m_binaryFile && (settingsFlags & eLogSettings::JsonLines))
+            m_layout = eLogLayout::Json;
+        else if (!m_binaryFile && (settingsFlags & eLogSettings::Logfmt))
+            m_layout = eLogLayout::Logfmt;
+        // logmerge orders the thread files by the timestamps of the records.
+        if ((settingsFlags & eLogSettings::PerThreadFiles) && (settingsFlags & eLogSettings::UseFile))
+        {
+            m_perThreadFiles = true;
+            m_showTimestamp = true;
+        }
+        m_upOutputter->setPerThreadFiles(m_perThreadFiles);
+    }
+    resetAsyncWriter(settingsFlags & eLogSettings::AsyncMode);
 }
 
 void Logger::setLogFilePath(const std::string& file, bool addProcessID)
 {
     if (m_upOutputter->m_isFile)
     {
+        const bool isAsync = m_upAsyncWriter != nullptr;
+        resetAsyncWriter(false);
+
         std::string path = file;
         if (addProcessID)
         {
@@ -194,107 +639,730 @@ void Logger::setLogFilePath(const std::string& file, bool addProcessID)
             else
                 path.insert(0, GetProcessID() + "_");
         }
-        m_upOutputter->m_filePath = path;
-        m_upOutputter->m_file.open(path, std::ios_base::app);
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_upOutputter->openFile(path);
+        }
+
+        resetAsyncWriter(isAsync);
     }
 }
 
-void Logger::print(const std::string& msg, eLogMsgType type)
+void Logger::setFlightRecorder(size_t capacity, const std::string& dumpPath, bool dumpOnError, bool handleSignals)
+{
+    // The threads that loaded the previous recorder before it was taken away finish with it first.
+    // The new recorder is created afterwards, so it can take over the signal handlers.
+    sFlightRecorder* previous = m_flightRecorder.exchange(nullptr);
+    while (m_flightRecorderUsers.load() != 0)
+        std::this_thread::yield();
+    delete previous;
+    if (capacity > 0)
+        m_flightRecorder.store(new sFlightRecorder(capacity, dumpPath, dumpOnError, handleSignals));
+}
+
+void Logger::dumpFlightRecorder()
+{
+    m_flightRecorderUsers.fetch_add(1);
+    if (sFlightRecorder* recorder = m_flightRecorder.load())
+        recorder->dump("request");
+    m_flightRecorderUsers.fetch_sub(1);
+}
+
+void Logger::setDurability(eLogDurability policy, unsigned value)
+{
+    // The housekeeper takes m_mtx, so it is never stopped while the mutex is held.
+    m_upHousekeeper.reset();
+
+    const bool isAsync = m_upAsyncWriter != nullptr;
+    resetAsyncWriter(false);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_upOutputter->commit();
+        m_upOutputter->m_durability = policy;
+        m_upOutputter->m_durabilityValue = std::max(value, 1u);
+    }
+    resetAsyncWriter(isAsync);
+    startHousekeeper();
+}
+
+void Logger::setRotation(uint64_t maxFileSize, std::chrono::seconds interval, unsigned maxFiles, bool compress)
+{
+    m_upHousekeeper.reset();
+
+    const bool isRotating = maxFileSize > 0 || interval.count() > 0;
+    std::unique_ptr<sLogArchiver> upArchiver;
+    if (isRotating && (compress || maxFiles > 0))
+        upArchiver = std::make_unique<sLogArchiver>(maxFiles, compress);
+
+    const bool isAsync = m_upAsyncWriter != nullptr;
+    resetAsyncWriter(false);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_upOutputter->m_maxFileSize = maxFileSize;
+        m_upOutputter->m_rotationInterval = interval;
+        m_upOutputter->m_fileOpenedAt = std::chrono::steady_clock::now();
+        std::swap(m_upOutputter->m_upArchiver, upArchiver);
+    }
+    resetAsyncWriter(isAsync);
+
+    // The previous archiver finishes its queued files here, outside the lock.
+    upArchiver.reset();
+    startHousekeeper();
+}
+
+void Logger::setLogIndex(unsigned blockKiB)
+{
+    const bool isAsync = m_upAsyncWriter != nullptr;
+    resetAsyncWriter(false);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_upOutputter->setIndex(static_cast<uint64_t>(blockKiB) * 1024);
+        m_indexedFile = blockKiB > 0;
+    }
+    resetAsyncWriter(isAsync);
+}
+
+void Logger::setSharedRing(const std::string& directory, size_t capacity)
+{
+    std::unique_ptr<sSharedRingWriter> upRing;
+    if (!directory.empty() && capacity > 0)
+        upRing = CreateSharedRing(directory, capacity);
+
+    const bool isAsync = m_upAsyncWriter != nullptr;
+    resetAsyncWriter(false);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        std::swap(m_upOutputter->m_upRing, upRing);
+        m_sharedRing = m_upOutputter->m_upRing != nullptr;
+    }
+    resetAsyncWriter(isAsync);
+    // The previous ring is closed outside the lock, the collector drains and removes it.
+}
+
+void Logger::setAsyncOptions(size_t queueCapacity, eLogBackpressure policy)
+{
+    m_asyncQueueCapacity = queueCapacity;
+    m_asyncBackpressure = policy;
+    if (m_upAsyncWriter)
+        resetAsyncWriter(true);
+}
+
+void Logger::flush()
 {
-    if (!m_isOn)
+    if (m_perThreadFiles)
+        FlushThreadFiles();
+
+    if (m_upAsyncWriter)
+    {
+        m_upAsyncWriter->flush();
         return;
+    }
+
     std::lock_guard<std::mutex> lock(m_mtx);
+    m_upOutputter->flush();
+}
 
-    if (type == eLogMsgType::Info)
-        m_upOutputter->colorPrint(ePrintColor::Green, "[Info]");
-    else if (type == eLogMsgType::Warning)
-        m_upOutputter->colorPrint(ePrintColor::Yellow, "[Warning]");
-    else if (type == eLogMsgType::Error)
-        m_upOutputter->colorPrint(ePrintColor::Red, "[ERROR]");
+unsigned long long Logger::droppedRecords()
+{
+    return m_droppedRecords + (m_upAsyncWriter ? m_upAsyncWriter->dropped() : 0);
+}
+
+void Logger::print(const std::string& msg, eLogMsgType type)
+{
+    if (!isEnabled(type))
+        return;
+
+    sLogRecord& record = newRecord();
+    appendPrefix(record, type);
+    appendMessage(record, msg);
+    endRecord(record);
+    dispatch(record);
+}
+
+void Logger::printFields(eLogMsgType type, std::string_view msg, std::initializer_list<sLogField> fields)
+{
+    if (!isEnabled(type))
+        return;
+
+    sLogRecord& record = newRecord();
+    appendPrefix(record, type);
+    appendMessage(record, msg);
+    for (const sLogField& field : fields)
+        appendField(record, field);
+    endRecord(record);
+    dispatch(record);
+}
+
+void Logger::reportSuppressed(eLogMsgType type, uint64_t count)
+{
+    CountTelemetry(eTelemetryCounter::Suppressed, count);
+    print(type, LOG_FORMAT("suppressed %llu similar messages"), static_cast<unsigned long long>(count));
+}
+
+void Logger::setThreadName(std::string_view name)
+{
+    sThreadInfo& info = CurrentThread();
+    info.m_name.assign(name.data(), name.size());
+    info.m_tag = ThreadTag(name);
+    sThreadRegistry& registry = ThreadRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mtx);
+    registry.m_names[info.m_index].assign(name.data(), name.size());
+}
+
+uint32_t Logger::threadIndex()
+{
+    return CurrentThread().m_index;
+}
+
+void Logger::startTimer(std::string_view name)
+{
+    sTimerStack& timers = t_timers;
+    if (timers.m_depth == timers.m_frames.size())
+        timers.m_frames.emplace_back();
+    sTimerFrame& frame = timers.m_frames[timers.m_depth++];
+    frame.m_name.assign(name.data(), name.size());
+    frame.m_startTicks = ClockTicks();
+}
+
+void Logger::stopTimer(eLogTimerUnits units, std::string_view msg)
+{
+    const uint64_t now = ClockTicks();
+    sTimerStack& timers = t_timers;
+    if (timers.m_depth == 0)
+        return;
+
+    const sTimerFrame& frame = timers.m_frames[--timers.m_depth];
+    const uint64_t elapsedNs = ElapsedNanoseconds(frame.m_startTicks, now);
+    if (m_aggregateTimers.load(std::memory_order_relaxed))
+        RecordTimerSample(frame.m_name, elapsedNs);
+    else
+        printTimer(ElapsedIn(units, elapsedNs), units, timers.m_depth, frame.m_name, msg);
+}
+
+void Logger::stopTimer(std::string_view name, eLogTimerUnits units, std::string_view msg)
+{
+    const uint64_t now = ClockTicks();
+    sTimerStack& timers = t_timers;
+    for (size_t i = timers.m_depth; i-- > 0;)
+    {
+        if (timers.m_frames[i].m_name != name)
+            continue;
+
+        // Moves the stopped frame past the running ones, the inner timers keep running.
+        const auto first = timers.m_frames.begin() + static_cast<std::ptrdiff_t>(i);
+        std::rotate(first, first + 1, timers.m_frames.begin() + static_cast<std::ptrdiff_t>(timers.m_depth));
+        const sTimerFrame& frame = timers.m_frames[--timers.m_depth];
+        const uint64_t elapsedNs = ElapsedNanoseconds(frame.m_startTicks, now);
+        if (m_aggregateTimers.load(std::memory_order_relaxed))
+            RecordTimerSample(frame.m_name, elapsedNs);
+        else
+            printTimer(ElapsedIn(units, elapsedNs), units, i, frame.m_name, msg);
+        return;
+    }
+}
+
+eLogClock Logger::setClock(eLogClock clock)
+{
+    return SetTscClock(clock == eLogClock::Tsc) ? eLogClock::Tsc : eLogClock::Steady;
+}
+
+void Logger::setTimerAggregation(bool isEnabled, std::chrono::milliseconds reportInterval)
+{
+    m_upTimerReporter.reset();
+    m_aggregateTimers.store(isEnabled, std::memory_order_relaxed);
+    if (isEnabled && reportInterval.count() > 0)
+        m_upTimerReporter = std::make_unique<sPeriodicTask>(reportInterval, []() { reportTimerStats(true); });
+}
+
+std::vector<sLogTimerStats> Logger::timerStats(bool reset)
+{
+    return CollectTimerStats(reset);
+}
+
+void Logger::reportTimerStats(bool reset)
+{
+    const std::vector<sLogTimerStats> stats = CollectTimerStats(reset);
+    if (!isEnabled(eLogMsgType::None))
+        return;
+
+    for (const sLogTimerStats& item : stats)
+    {
+        sLogRecord& record = newRecord();
+        if (m_layout != eLogLayout::Text)
+        {
+            appendPrefix(record, eLogMsgType::None);
+            appendMessage(record, "timer stats");
+            appendField(record, { "timer", item.m_label });
+            appendField(record, { "count", item.m_count });
+            appendField(record, { "min_us", item.m_minNs / 1000.0 });
+            appendField(record, { "mean_us", item.m_meanNs / 1000.0 });
+            appendField(record, { "p50_us", item.m_p50Ns / 1000.0 });
+            appendField(record, { "p99_us", item.m_p99Ns / 1000.0 });
+            appendField(record, { "max_us", item.m_maxNs / 1000.0 });
+            endRecord(record);
+            dispatch(record);
+            continue;
+        }
+
+        record.appendTag(ePrintColor::Cyan, "[timer stats]");
+        if (m_useThreadID)
+            appendThreadID(record);
+        record.append(": ", 2);
+        record.append(item.m_label);
+        record.append(":", 1);
+
+        char text[256];
+        const int size = std::snprintf(text, sizeof(text),
+            " count=%llu min=%.3fus mean=%.3fus p50=%.3fus p99=%.3fus max=%.3fus\n",
+            static_cast<unsigned long long>(item.m_count), item.m_minNs / 1000.0, item.m_meanNs / 1000.0,
+            item.m_p50Ns / 1000.0, item.m_p99Ns / 1000.0, item.m_maxNs / 1000.0);
+        record.append(text, static_cast<size_t>(std::max(size, 0)));
+        dispatch(record);
+    }
+}
+
+bool Logger::memoryUsage(sLogMemoryUsage& usage)
+{
+    return ReadMemoryUsage(usage);
+}
+
+void Logger::startMemoryRegion(std::string_view name)
+{
+    sMemoryStack& regions = t_memoryRegions;
+    if (regions.m_depth == regions.m_frames.size())
+        regions.m_frames.emplace_back();
+    sMemoryFrame& frame = regions.m_frames[regions.m_depth++];
+    frame.m_name.assign(name.data(), name.size());
+    frame.m_start = sLogMemoryUsage();
+    ReadMemoryUsage(frame.m_start, true);
+}
+
+void Logger::stopMemoryRegion(std::string_view msg)
+{
+    sLogMemoryUsage now;
+    const bool hasUsage = ReadMemoryUsage(now, true);
+    sMemoryStack& regions = t_memoryRegions;
+    if (regions.m_depth == 0)
+        return;
+
+    const sMemoryFrame& frame = regions.m_frames[--regions.m_depth];
+    if (hasUsage)
+        printMemory(frame.m_name, msg, now, frame.m_start);
+}
+
+void Logger::setMemorySampler(std::chrono::milliseconds interval, bool printSamples)
+{
+    m_upMemorySampler.reset();
+    if (interval.count() <= 0)
+        return;
+
+    auto last = std::make_shared<sLogMemoryUsage>();
+    if (!ReadMemoryUsage(*last))
+        return;
+    m_upMemorySampler = std::make_unique<sPeriodicTask>(interval, [last, printSamples]() {
+        sLogMemoryUsage now;
+        if (!ReadMemoryUsage(now))
+            return;
+        RecordMemorySample(now);
+        if (printSamples)
+            printMemory("memory sample", {}, now, *last);
+        *last = now;
+    });
+}
+
+sLogMemoryStats Logger::memoryStats(bool reset)
+{
+    return CollectMemoryStats(reset);
+}
+
+void Logger::setTelemetry(bool isEnabled, std::chrono::milliseconds summaryInterval)
+{
+    m_upTelemetryReporter.reset();
+    SetTelemetry(isEnabled);
+    if (isEnabled && summaryInterval.count() > 0)
+        m_upTelemetryReporter = std::make_unique<sPeriodicTask>(summaryInterval, []() { reportTelemetry(true); });
+}
+
+sLogTelemetry Logger::telemetry(bool reset)
+{
+    return CollectTelemetry(reset);
+}
+
+void Logger::reportTelemetry(bool reset)
+{
+    const sLogTelemetry counters = CollectTelemetry(reset);
+    if (!isEnabled(eLogMsgType::None))
+        return;
+
+    uint64_t records = 0;
+    for (uint64_t count : counters.m_records)
+        records += count;
+    const double fileWriteMeanUs = counters.m_fileWrites
+        ? static_cast<double>(counters.m_fileWriteNs) / 1000.0 / static_cast<double>(counters.m_fileWrites) : 0.0;
+    const double lockWaitUs = static_cast<double>(counters.m_lockWaitNs) / 1000.0;
 
+    sLogRecord& record = newRecord();
+    if (m_layout != eLogLayout::Text)
+    {
+        appendPrefix(record, eLogMsgType::None);
+        appendMessage(record, "telemetry");
+        appendField(record, { "records", records });
+        appendField(record, { "errors", counters.m_records[static_cast<size_t>(eLogMsgType::Error)] });
+        appendField(record, { "warnings", counters.m_records[static_cast<size_t>(eLogMsgType::Warning)] });
+        appendField(record, { "cout_bytes", counters.m_coutBytes });
+        appendField(record, { "cerr_bytes", counters.m_cerrBytes });
+        appendField(record, { "file_bytes", counters.m_fileBytes });
+        appendField(record, { "thread_file_bytes", counters.m_threadFileBytes });
+        appendField(record, { "file_writes", counters.m_fileWrites });
+        appendField(record, { "file_write_mean_us", fileWriteMeanUs });
+        appendField(record, { "file_syncs", counters.m_fileSyncs });
+        appendField(record, { "lock_waits", counters.m_lockWaits });
+        appendField(record, { "lock_wait_us", lockWaitUs });
+        appendField(record, { "dropped", counters.m_dropped });
+        appendField(record, { "suppressed", counters.m_suppressed });
+        endRecord(record);
+        dispatch(record);
+        return;
+    }
+
+    record.appendTag(ePrintColor::Cyan, "[telemetry]");
     if (m_useThreadID)
-        printThreadID();
-    m_upOutputter->print(type == eLogMsgType::None && !m_useThreadID
-        ? msg + "\n" : ": " + msg + "\n");
+        appendThreadID(record);
+
+    char text[512];
+    const int size = std::snprintf(text, sizeof(text),
+        ": records=%llu errors=%llu warnings=%llu cout=%lluB cerr=%lluB file=%lluB thread_files=%lluB"
+        " file_writes=%llu file_write_mean=%.3fus file_syncs=%llu lock_waits=%llu lock_wait=%.3fus dropped=%llu suppressed=%llu\n",
+        static_cast<unsigned long long>(records),
+        static_cast<unsigned long long>(counters.m_records[static_cast<size_t>(eLogMsgType::Error)]),
+        static_cast<unsigned long long>(counters.m_records[static_cast<size_t>(eLogMsgType::Warning)]),
+        static_cast<unsigned long long>(counters.m_coutBytes), static_cast<unsigned long long>(counters.m_cerrBytes),
+        static_cast<unsigned long long>(counters.m_fileBytes), static_cast<unsigned long long>(counters.m_threadFileBytes),
+        static_cast<unsigned long long>(counters.m_fileWrites), fileWriteMeanUs, static_cast<unsigned long long>(counters.m_fileSyncs),
+        static_cast<unsigned long long>(counters.m_lockWaits), lockWaitUs,
+        static_cast<unsigned long long>(counters.m_dropped), static_cast<unsigned long long>(counters.m_suppressed));
+    record.append(text, static_cast<size_t>(std::max(size, 0)));
+    dispatch(record);
 }
 
-void Logger::startTimer(const std::string& msg)
+void Logger::printMemory(std::string_view name, std::string_view msg,
+    const sLogMemoryUsage& now, const sLogMemoryUsage& before)
 {
-    if (!m_isOn)
+    if (!isEnabled(eLogMsgType::None))
         return;
-    std::lock_guard<std::mutex> lock(m_mtx);
 
-    startTimerForCurrThread();
-    m_upOutputter->colorPrint(ePrintColor::Cyan, "[timer start]");
+    const auto minorFaults = static_cast<unsigned long long>(now.m_minorFaults - before.m_minorFaults);
+    const auto majorFaults = static_cast<unsigned long long>(now.m_majorFaults - before.m_majorFaults);
+    sLogRecord& record = newRecord();
+    if (m_layout != eLogLayout::Text)
+    {
+        std::string& text = t_messageBuffer;
+        text.clear();
+        AppendTimerMessage(text, name, msg);
+        appendPrefix(record, eLogMsgType::None);
+        appendMessage(record, text);
+        appendField(record, { "rss_kib", now.m_rssBytes / 1024 });
+        appendField(record, { "rss_delta_kib", KibibytesDelta(now.m_rssBytes, before.m_rssBytes) });
+        appendField(record, { "virtual_kib", now.m_virtualBytes / 1024 });
+        appendField(record, { "virtual_delta_kib", KibibytesDelta(now.m_virtualBytes, before.m_virtualBytes) });
+        appendField(record, { "minor_faults", minorFaults });
+        appendField(record, { "major_faults", majorFaults });
+        endRecord(record);
+        dispatch(record);
+        return;
+    }
+
+    record.appendTag(ePrintColor::Cyan, "[memory]");
     if (m_useThreadID)
-        printThreadID();
-    m_upOutputter->print(": " + msg + "\n");
+        appendThreadID(record);
+    record.append(": ", 2);
+    record.appendEncoded([name, msg](std::string& out) { AppendTimerMessage(out, name, msg); });
+
+    char text[192];
+    const int size = std::snprintf(text, sizeof(text),
+        " rss=%lluKiB(%+lld) virtual=%lluKiB(%+lld) minflt=%llu majflt=%llu\n",
+        static_cast<unsigned long long>(now.m_rssBytes / 1024), KibibytesDelta(now.m_rssBytes, before.m_rssBytes),
+        static_cast<unsigned long long>(now.m_virtualBytes / 1024), KibibytesDelta(now.m_virtualBytes, before.m_virtualBytes),
+        minorFaults, majorFaults);
+    record.append(text, static_cast<size_t>(std::max(size, 0)));
+    dispatch(record);
 }
 
-void Logger::stopTimer(eLogTimerUnits units, const std::string& msg)
+void Logger::printTimer(long long elapsed, eLogTimerUnits units, size_t depth,
+    std::string_view name, std::string_view msg)
 {
-    if (!m_isOn)
+    if (!isEnabled(eLogMsgType::None))
         return;
-    std::lock_guard<std::mutex> lock(m_mtx);
 
-    long long time = stopTimerForCurrThread(units);
-    if (time == FAILED_TIME_MEASUREMENT)
+    sLogRecord& record = newRecord();
+    if (m_layout != eLogLayout::Text)
+    {
+        // The measurement goes into numeric fields instead of the tag.
+        std::string& text = t_messageBuffer;
+        text.clear();
+        AppendTimerMessage(text, name, msg);
+        appendPrefix(record, eLogMsgType::None);
+        appendMessage(record, text);
+        appendField(record, { "timer", name });
+        appendField(record, { "elapsed", elapsed });
+        appendField(record, { "units", UnitsName(units) });
+        appendField(record, { "depth", depth });
+        endRecord(record);
+        dispatch(record);
+        return;
+    }
+
+    char timeStr[MaxIntegerChars];
+    const char* const timeEnd = WriteInteger(timeStr, elapsed);
+
+    record.beginColor(ePrintColor::Cyan);
+    record.append("[timer stop ");
+    record.append(timeStr, static_cast<size_t>(timeEnd - timeStr));
+    record.append(" ", 1);
+    record.append(UnitsName(units));
+    record.append("]", 1);
+    record.endColor();
+    if (m_useThreadID)
+        appendThreadID(record);
+    record.append(": ", 2);
+    for (size_t i = 0; i < depth; ++i)
+        record.append("  ", 2);
+    record.appendEncoded([name, msg](std::string& out) { AppendTimerMessage(out, name, msg); });
+    record.append("\n", 1);
+    dispatch(record);
+}
+
+sLogRecord& Logger::newRecord()
+{
+    sLogRecord& record = NewRecord();
+    // The index keeps the time span of every block, the collector orders the records of the shared rings by their time.
+    if (m_showTimestamp || m_binaryFile || m_indexedFile || m_sharedRing)
+        record.m_time = WallClockMicroseconds();
+    // The structured layouts write the time as a field of the prefix.
+    if (m_showTimestamp && m_layout == eLogLayout::Text)
+    {
+        record.append(TimestampText(record.m_time), TIMESTAMP_LENGTH);
+        record.m_messageOffset = record.m_plain.size();
+    }
+    return record;
+}
+
+void Logger::appendPrefix(sLogRecord& record, eLogMsgType type)
+{
+    record.m_type = type;
+    record.m_hasThreadTag = m_useThreadID;
+    if (m_layout != eLogLayout::Text)
+    {
+        const eLogLayout layout = m_layout;
+        record.appendEncoded([layout, type, &record](std::string& out) {
+            if (layout == eLogLayout::Json)
+                out.push_back('{');
+            if (m_showTimestamp)
+            {
+                char time[TIMESTAMP_LENGTH];
+                std::memcpy(time, TimestampText(record.m_time), TIMESTAMP_LENGTH);
+                time[10] = 'T';
+                AppendFieldKey(out, layout, 0, "ts");
+                AppendStringValue(out, layout, std::string_view(time, TIMESTAMP_LENGTH - 1));
+            }
+            if (type != eLogMsgType::None)
+            {
+                AppendFieldKey(out, layout, 0, "level");
+                AppendStringValue(out, layout, LevelName(type));
+            }
+            if (m_useThreadID)
+            {
+                AppendFieldKey(out, layout, 0, "thread");
+                AppendStringValue(out, layout, CurrentThread().m_name);
+            }
+            AppendFieldKey(out, layout, 0, "msg");
+        });
+        record.m_messageOffset = record.m_plain.size();
         return;
-    std::string unitsStr;
-    if (units == eLogTimerUnits::Seconds)
-        unitsStr = " sec";
-    else if (units == eLogTimerUnits::Milliseconds)
-        unitsStr = " millisec";
-    else if (units == eLogTimerUnits::Microseconds)
-        unitsStr = " microsec";
-    else if (units == eLogTimerUnits::Nanoseconds)
-        unitsStr = " nanosec";
-
-    m_upOutputter->colorPrint(ePrintColor::Cyan, 
-        "[timer stop " + std::to_string(time) + unitsStr + "]");
+    }
+
+    if (type == eLogMsgType::Trace)
+        record.appendTag(ePrintColor::White, "[Trace]");
+    else if (type == eLogMsgType::Debug)
+        record.appendTag(ePrintColor::Blue, "[Debug]");
+    else if (type == eLogMsgType::Info)
+        record.appendTag(ePrintColor::Green, "[Info]");
+    else if (type == eLogMsgType::Warning)
+        record.appendTag(ePrintColor::Yellow, "[Warning]");
+    else if (type == eLogMsgType::Error)
+        record.appendTag(ePrintColor::Red, "[ERROR]");
+
     if (m_useThreadID)
-        printThreadID();
-    m_upOutputter->print(": " + msg + "\n");
+        appendThreadID(record);
+    if (type != eLogMsgType::None || m_useThreadID)
+        record.append(": ", 2);
+    record.m_messageOffset = record.m_plain.size();
 }
 
-void Logger::startTimerForCurrThread()
+void Logger::appendThreadID(sLogRecord& record)
 {
-    auto id = std::this_thread::get_id();
-    if (m_upThreadsTimers.find(id) == m_upThreadsTimers.end())
-        m_upThreadsTimers.insert(std::make_pair(id, std::make_unique<sTime>()));
-    m_upThreadsTimers[id]->start();
+    record.beginColor(ePrintColor::Magenta);
+    record.append(CurrentThread().m_tag);
+    record.endColor();
 }
 
-long long Logger::stopTimerForCurrThread(eLogTimerUnits units)
+void Logger::appendMessage(sLogRecord& record, std::string_view msg)
 {
-    auto id = std::this_thread::get_id();
-    if (m_upThreadsTimers.find(id) == m_upThreadsTimers.end())
-        return FAILED_TIME_MEASUREMENT;
+    if (m_layout == eLogLayout::Text)
+        record.append(msg.data(), msg.size());
+    else
+    {
+        const eLogLayout layout = m_layout;
+        record.appendEncoded([layout, msg](std::string& out) { AppendStringValue(out, layout, msg); });
+    }
+}
 
-    long long res = 0;
-    auto&& timer = m_upThreadsTimers[id];
-    if (units == eLogTimerUnits::Seconds)
-        res = timer->stopSeconds();
-    if (units == eLogTimerUnits::Milliseconds)
-        res = timer->stopMilliseconds();
-    if (units == eLogTimerUnits::Microseconds)
-        res = timer->stopMicroseconds();
-    if (units == eLogTimerUnits::Nanoseconds)
-        res = timer->stopNanoseconds();
+void Logger::appendField(sLogRecord& record, const sLogField& field)
+{
+    const eLogLayout layout = m_layout;
+    record.appendEncoded([layout, &field](std::string& out) {
+        AppendFieldKey(out, layout, 0, field.m_key);
+        AppendFieldValue(out, layout, field);
+    });
+}
 
-    m_upThreadsTimers.erase(id);
-    return res;
+void Logger::endRecord(sLogRecord& record)
+{
+    if (m_layout == eLogLayout::Json)
+        record.append("}\n", 2);
+    else
+        record.append("\n", 1);
 }
 
-void Logger::printThreadID()
+void Logger::printObjectText(eLogMsgType type, std::string_view text)
 {
-    std::ostringstream ss;
-    ss << std::this_thread::get_id();
-    m_upOutputter->colorPrint(ePrintColor::Magenta, "[thread " + ss.str() + "]");
+    sLogRecord& record = newRecord();
+    if (type != eLogMsgType::None || m_layout != eLogLayout::Text)
+        appendPrefix(record, type);
+    appendMessage(record, text);
+    endRecord(record);
+    dispatch(record);
 }
 
-void Logger::printObjectStr(const std::string& objStr)
+std::string& Logger::objectBufferForCurrThread()
+{
+    return t_objectBuffer;
+}
+
+std::string& Logger::argsBufferForCurrThread()
+{
+    return t_argsBuffer;
+}
+
+std::string& Logger::textBufferForCurrThread()
+{
+    return t_textBuffer;
+}
+
+void Logger::printArgs(eLogMsgType type, const char* format, const std::string& args, bool isStaticFormat)
+{
+    sLogRecord& record = newRecord();
+    appendPrefix(record, type);
+    // Thread files and the flight recorder take the record before it is queued, so they need the text right away.
+    // The structured layouts escape the message, so it is formatted into a buffer first.
+    const bool isDeferred = m_deferFormatting && m_upAsyncWriter && !m_perThreadFiles && !m_flightRecorder.load(std::memory_order_relaxed)
+        && m_layout == eLogLayout::Text;
+    if (isDeferred || m_binaryFile)
+    {
+        // A queued record is written after the call returned and the caller's format may be gone.
+        record.setFormat(format, !isStaticFormat && m_upAsyncWriter);
+        record.m_args.assign(args);
+    }
+    if (isDeferred)
+        record.m_isDeferred = true;
+    else if (m_layout == eLogLayout::Text)
+    {
+        record.appendFormatted(format, args);
+        record.append("\n", 1);
+    }
+    else
+    {
+        std::string& text = t_messageBuffer;
+        text.clear();
+        FormatLogArgs(format, args.data(), args.size(), text);
+        appendMessage(record, text);
+        endRecord(record);
+    }
+    dispatch(record);
+}
+
+void Logger::dispatch(sLogRecord& record)
+{
+    if (m_binaryFile || m_perThreadFiles || m_indexedFile)
+        record.m_threadIndex = CurrentThread().m_index;
+    CountTelemetryRecord(record.m_type);
+
+    if (m_flightRecorder.load(std::memory_order_relaxed))
+    {
+        // Counted before the recorder is loaded, so setFlightRecorder cannot delete it meanwhile.
+        m_flightRecorderUsers.fetch_add(1);
+        if (sFlightRecorder* recorder = m_flightRecorder.load())
+        {
+            recorder->add(record.m_plain.data(), record.m_plain.size());
+            if (record.m_type == eLogMsgType::Error && recorder->dumpsOnError())
+                recorder->dump("error");
+        }
+        m_flightRecorderUsers.fetch_sub(1);
+    }
+
+    // The file of the thread takes no shared lock, only the shared outputs do.
+    if (m_perThreadFiles)
+        WriteThreadFile(record);
+    if (!m_upOutputter->hasOutputs())
+        return;
+
+    if (m_upAsyncWriter)
+    {
+        m_upAsyncWriter->push(record);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mtx, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        const uint64_t start = ClockTicks();
+        lock.lock();
+        CountTelemetry(eTelemetryCounter::LockWaitNs, ElapsedNanoseconds(start, ClockTicks()));
+        CountTelemetry(eTelemetryCounter::LockWaits);
+    }
+    m_upOutputter->write(record);
+}
+
+void Logger::resetAsyncWriter(bool isAsync)
+{
+    // Holding the mutex keeps the housekeeper away from the outputs while the writer drains.
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_upAsyncWriter)
+    {
+        m_droppedRecords += m_upAsyncWriter->dropped();
+        m_upAsyncWriter.reset();
+    }
+
+    if (isAsync)
+    {
+        m_upAsyncWriter = std::make_unique<sAsyncWriter>(m_asyncQueueCapacity, m_asyncBackpressure,
+            [](sLogRecord& record) { m_upOutputter->write(record); },
+            []() { m_upOutputter->flush(); },
+            []() { m_upOutputter->onIdle(); });
+    }
+}
+
+void Logger::housekeeping()
 {
     std::lock_guard<std::mutex> lock(m_mtx);
-    m_upOutputter->print(objStr + "\n");
+    // In the asynchronous mode the writer thread owns the outputs and runs onIdle itself.
+    if (!m_upAsyncWriter)
+        m_upOutputter->onIdle();
+}
+
+void Logger::startHousekeeper()
+{
+    const std::chrono::milliseconds period = m_upOutputter->housekeepingPeriod();
+    if (period.count() > 0)
+        m_upHousekeeper = std::make_unique<sPeriodicTask>(period, &Logger::housekeeping);
 }
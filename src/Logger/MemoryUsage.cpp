@@ -0,0 +1,113 @@
+#include "MemoryUsage.h"
+
+#include <algorithm>
+#include <mutex>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <sys/resource.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+#define STATM_BUFFER_SIZE 128
+
+    // Never destroyed, the sampler may still run while static objects are destroyed.
+    struct sMemoryStatsRegistry
+    {
+        std::mutex m_mtx;
+        sLogMemoryStats m_stats;
+    };
+
+    sMemoryStatsRegistry& Registry()
+    {
+        static sMemoryStatsRegistry* registry = new sMemoryStatsRegistry;
+        return *registry;
+    }
+
+#ifdef __linux__
+    // Opened once: the kernel regenerates the text on every read from offset 0.
+    int StatmFile()
+    {
+        static const int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        return fd;
+    }
+
+    uint64_t PageSize()
+    {
+        static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        return pageSize;
+    }
+
+    const char* ParseNumber(const char* pos, const char* end, uint64_t& value)
+    {
+        while (pos < end && *pos == ' ')
+            ++pos;
+        value = 0;
+        for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos)
+            value = value * 10 + static_cast<uint64_t>(*pos - '0');
+        return pos;
+    }
+#endif
+}
+
+bool ReadMemoryUsage(sLogMemoryUsage& usage, bool isThreadFaults)
+{
+#ifdef __linux__
+    const int fd = StatmFile();
+    if (fd < 0)
+        return false;
+
+    // "size resident shared text lib data dt", in pages.
+    char text[STATM_BUFFER_SIZE];
+    const ssize_t size = pread(fd, text, sizeof(text), 0);
+    if (size <= 0)
+        return false;
+    uint64_t virtualPages = 0;
+    uint64_t residentPages = 0;
+    const char* const end = text + size;
+    ParseNumber(ParseNumber(text, end, virtualPages), end, residentPages);
+    usage.m_virtualBytes = virtualPages * PageSize();
+    usage.m_rssBytes = residentPages * PageSize();
+
+#ifdef RUSAGE_THREAD
+    const int who = isThreadFaults ? RUSAGE_THREAD : RUSAGE_SELF;
+#else
+    (void)isThreadFaults;
+    const int who = RUSAGE_SELF;
+#endif
+    rusage resources = {};
+    if (getrusage(who, &resources) == 0)
+    {
+        usage.m_minorFaults = static_cast<uint64_t>(resources.ru_minflt);
+        usage.m_majorFaults = static_cast<uint64_t>(resources.ru_majflt);
+    }
+    return true;
+#else
+    (void)usage;
+    (void)isThreadFaults;
+    return false;
+#endif
+}
+
+void RecordMemorySample(const sLogMemoryUsage& usage)
+{
+    sMemoryStatsRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.m_mtx);
+    sLogMemoryStats& stats = registry.m_stats;
+    ++stats.m_samples;
+    stats.m_last = usage;
+    stats.m_peakRssBytes = std::max(stats.m_peakRssBytes, usage.m_rssBytes);
+    stats.m_peakVirtualBytes = std::max(stats.m_peakVirtualBytes, usage.m_virtualBytes);
+}
+
+sLogMemoryStats CollectMemoryStats(bool reset)
+{
+    sMemoryStatsRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.m_mtx);
+    const sLogMemoryStats stats = registry.m_stats;
+    if (reset)
+        registry.m_stats = sLogMemoryStats();
+    return stats;
+}
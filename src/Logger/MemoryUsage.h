@@ -0,0 +1,28 @@
+/**
+ * @file MemoryUsage.h
+ * @brief Memory usage of the process and the statistics of the memory sampler.
+ */
+
+#pragma once
+
+#include "Logger.h"
+
+/**
+ * @brief Reads the resident and virtual size and the page fault counts of the process.
+ * @param isThreadFaults Whether the fault counts are those of the current thread only.
+ * @return false if the platform offers no such figures.
+ * @note Sizes come from /proc/self/statm, read with a file descriptor kept open for the
+ * life of the process, and the fault counts from getrusage. A call takes about a microsecond.
+ */
+bool ReadMemoryUsage(sLogMemoryUsage& usage, bool isThreadFaults = false);
+
+/**
+ * @brief Adds a snapshot of the sampler to the statistics.
+ */
+void RecordMemorySample(const sLogMemoryUsage& usage);
+
+/**
+ * @brief Returns the statistics of the snapshots recorded so far.
+ * @param reset Whether the statistics start over.
+ */
+sLogMemoryStats CollectMemoryStats(bool reset);
@@ -0,0 +1,30 @@
+#include "PeriodicTask.h"
+
+sPeriodicTask::sPeriodicTask(std::chrono::milliseconds period, std::function<void()> task)
+    : m_period(period.count() > 0 ? period : std::chrono::milliseconds(1))
+    , m_task(std::move(task))
+{
+    m_thread = std::thread(&sPeriodicTask::run, this);
+}
+
+sPeriodicTask::~sPeriodicTask()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void sPeriodicTask::run()
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while (!m_cv.wait_for(lock, m_period, [this]() { return m_stop; }))
+    {
+        lock.unlock();
+        m_task();
+        lock.lock();
+    }
+}
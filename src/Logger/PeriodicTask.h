@@ -0,0 +1,41 @@
+/**
+ * @file PeriodicTask.h
+ * @brief Background thread that runs a task at a fixed interval.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Runs the task on its own thread every period until destroyed.
+ * @note The destructor waits for a running task to finish, so the task must not wait
+ * for anything held by the code that destroys the object.
+ */
+struct sPeriodicTask
+{
+    sPeriodicTask(std::chrono::milliseconds period, std::function<void()> task);
+    ~sPeriodicTask();
+
+    sPeriodicTask(const sPeriodicTask&) = delete;
+    sPeriodicTask& operator=(const sPeriodicTask&) = delete;
+
+    std::chrono::milliseconds period() const
+    {
+        return m_period;
+    }
+
+private:
+    void run();
+
+    const std::chrono::milliseconds m_period;
+    std::function<void()> m_task;
+    bool m_stop = false;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
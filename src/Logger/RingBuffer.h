@@ -0,0 +1,121 @@
+/**
+ * @file RingBuffer.h
+ * @brief Bounded lock-free queue used by the asynchronous logging mode.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Bounded lock-free ring buffer with per-cell sequence numbers.
+ * @tparam T Type of the stored elements. Must be default constructible and swappable.
+ * @note Any number of threads may push. Popping is also safe from several threads,
+ * which lets producers evict the oldest element when the buffer is full.
+ * Values are swapped in and out of the slots, so the resources they own (e.g. string
+ * capacity) circulate between producers and the consumer instead of being reallocated.
+ */
+template <typename T>
+struct sRingBuffer
+{
+    /**
+     * @brief Creates a ring buffer.
+     * @param capacity Requested capacity, rounded up to the next power of two.
+     */
+    explicit sRingBuffer(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        m_mask = size - 1;
+        m_cells.reset(new sCell[size]);
+        for (size_t i = 0; i < size; ++i)
+            m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+
+    sRingBuffer(const sRingBuffer&) = delete;
+    sRingBuffer& operator=(const sRingBuffer&) = delete;
+
+    /**
+     * @brief Tries to swap the value into the buffer.
+     * @return false if the buffer is full. In that case the value is left untouched.
+     * @note On success the value receives the stale content of the slot.
+     */
+    bool tryPush(T& value)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            sCell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.m_sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    using std::swap;
+                    swap(cell.m_value, value);
+                    cell.m_sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Tries to swap the oldest value out of the buffer.
+     * @return false if the buffer is empty.
+     */
+    bool tryPop(T& value)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            sCell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.m_sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    using std::swap;
+                    swap(cell.m_value, value);
+                    cell.m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Returns true if the buffer looks empty at the moment of the call.
+     */
+    bool empty() const
+    {
+        return m_enqueuePos.load(std::memory_order_acquire) == m_dequeuePos.load(std::memory_order_acquire);
+    }
+
+private:
+    struct sCell
+    {
+        std::atomic<size_t> m_sequence;
+        T m_value;
+    };
+
+    std::unique_ptr<sCell[]> m_cells;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+    alignas(64) std::atomic<size_t> m_dequeuePos{ 0 };
+};
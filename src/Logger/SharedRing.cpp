@@ -0,0 +1,247 @@
+#include "SharedRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <system_error>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+#define RING_SIGNATURE "SLRG"
+#define RING_SIGNATURE_LENGTH 4
+#define RING_VERSION 1
+#define RING_MIN_CAPACITY 4096
+#define TEMPORARY_FILE_EXT ".tmp"
+
+    // Precedes the text of every record in the ring.
+    struct sRingFrame
+    {
+        uint32_t m_size;
+        uint8_t m_type;
+        uint8_t m_reserved[3];
+        int64_t m_time;
+    };
+
+    static_assert(sizeof(sRingFrame) == 16, "the frames are stored as they are in memory");
+
+    uint64_t RoundUpToPowerOfTwo(uint64_t value)
+    {
+        uint64_t result = RING_MIN_CAPACITY;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    // The copies wrap around the end of the ring.
+    void CopyIn(char* ring, uint64_t mask, uint64_t position, const void* data, size_t size)
+    {
+        const size_t offset = static_cast<size_t>(position & mask);
+        const size_t first = std::min<size_t>(size, static_cast<size_t>(mask + 1) - offset);
+        std::memcpy(ring + offset, data, first);
+        std::memcpy(ring, static_cast<const char*>(data) + first, size - first);
+    }
+
+    void CopyOut(const char* ring, uint64_t mask, uint64_t position, void* data, size_t size)
+    {
+        const size_t offset = static_cast<size_t>(position & mask);
+        const size_t first = std::min<size_t>(size, static_cast<size_t>(mask + 1) - offset);
+        std::memcpy(data, ring + offset, first);
+        std::memcpy(static_cast<char*>(data) + first, ring, size - first);
+    }
+
+    // A process ID reused by a new process of the same service gets a ring of its own.
+    std::string NewRingPath(const std::string& directory, const std::string& processID)
+    {
+        std::error_code error;
+        const std::string base = (std::filesystem::path(directory) / processID).string();
+        std::string candidate = base + SharedRingExtension;
+        for (unsigned i = 1; std::filesystem::exists(candidate, error); ++i)
+            candidate = base + "-" + std::to_string(i) + SharedRingExtension;
+        return candidate;
+    }
+}
+
+sSharedRingWriter::sSharedRingWriter(sSharedRingHeader* header, size_t mappedSize)
+    : m_header(header)
+    , m_data(reinterpret_cast<char*>(header) + sizeof(sSharedRingHeader))
+    , m_mappedSize(mappedSize)
+    , m_mask(header->m_capacity - 1)
+{
+}
+
+sSharedRingWriter::~sSharedRingWriter()
+{
+    m_header->m_isClosed.store(1, std::memory_order_release);
+#ifndef _WIN32
+    ::munmap(m_header, m_mappedSize);
+#endif
+}
+
+bool sSharedRingWriter::write(int64_t time, eLogMsgType type, std::string_view text)
+{
+    const uint64_t frameSize = sizeof(sRingFrame) + text.size();
+    const uint64_t capacity = m_mask + 1;
+    const uint64_t written = m_header->m_written.load(std::memory_order_relaxed);
+    if (frameSize > capacity - (written - m_readCache))
+    {
+        m_readCache = m_header->m_read.load(std::memory_order_acquire);
+        if (frameSize > capacity - (written - m_readCache))
+        {
+            m_header->m_dropped.store(m_header->m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    sRingFrame frame = {};
+    frame.m_size = static_cast<uint32_t>(text.size());
+    frame.m_type = static_cast<uint8_t>(type);
+    frame.m_time = time;
+    CopyIn(m_data, m_mask, written, &frame, sizeof(frame));
+    CopyIn(m_data, m_mask, written + sizeof(frame), text.data(), text.size());
+    // The collector sees the record only after all of its bytes.
+    m_header->m_written.store(written + frameSize, std::memory_order_release);
+    return true;
+}
+
+std::unique_ptr<sSharedRingWriter> CreateSharedRing(const std::string& directory, size_t capacity)
+{
+#ifdef _WIN32
+    (void)directory;
+    (void)capacity;
+    return nullptr;
+#else
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    const std::string path = NewRingPath(directory, std::to_string(getpid()));
+    const std::string temporaryPath = path + TEMPORARY_FILE_EXT;
+
+    const uint64_t ringCapacity = RoundUpToPowerOfTwo(capacity);
+    const size_t mappedSize = static_cast<size_t>(sizeof(sSharedRingHeader) + ringCapacity);
+    const int fd = ::open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return nullptr;
+    void* view = ::ftruncate(fd, static_cast<off_t>(mappedSize)) == 0
+        ? ::mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+        : MAP_FAILED;
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        ::unlink(temporaryPath.c_str());
+        return nullptr;
+    }
+
+    // The ring appears under its name only when the header is complete.
+    auto* header = new (view) sSharedRingHeader{};
+    std::memcpy(header->m_signature, RING_SIGNATURE, RING_SIGNATURE_LENGTH);
+    header->m_version = RING_VERSION;
+    header->m_capacity = ringCapacity;
+    header->m_processID = static_cast<uint64_t>(getpid());
+    if (::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        ::munmap(view, mappedSize);
+        ::unlink(temporaryPath.c_str());
+        return nullptr;
+    }
+    return std::unique_ptr<sSharedRingWriter>(new sSharedRingWriter(header, mappedSize));
+#endif
+}
+
+sSharedRingReader::sSharedRingReader(const std::string& path)
+{
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat info = {};
+    void* view = MAP_FAILED;
+    const auto size = static_cast<size_t>(::fstat(fd, &info) == 0 ? info.st_size : 0);
+    if (size > sizeof(sSharedRingHeader))
+        view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return;
+
+    auto* header = static_cast<sSharedRingHeader*>(view);
+    const uint64_t capacity = header->m_capacity;
+    if (std::memcmp(header->m_signature, RING_SIGNATURE, RING_SIGNATURE_LENGTH) != 0
+        || header->m_version != RING_VERSION || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || sizeof(sSharedRingHeader) + capacity != size)
+    {
+        ::munmap(view, size);
+        return;
+    }
+    m_header = header;
+    m_data = static_cast<const char*>(view) + sizeof(sSharedRingHeader);
+    m_mappedSize = size;
+#else
+    (void)path;
+#endif
+}
+
+sSharedRingReader::~sSharedRingReader()
+{
+#ifndef _WIN32
+    if (m_header)
+        ::munmap(m_header, m_mappedSize);
+#endif
+}
+
+size_t sSharedRingReader::read(std::vector<sSharedRingRecord>& records)
+{
+    const uint64_t mask = m_header->m_capacity - 1;
+    const uint64_t written = m_header->m_written.load(std::memory_order_acquire);
+    uint64_t position = m_header->m_read.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (written - position >= sizeof(sRingFrame))
+    {
+        sRingFrame frame;
+        CopyOut(m_data, mask, position, &frame, sizeof(frame));
+        // A damaged ring is skipped up to what the producer published.
+        if (frame.m_size > written - position - sizeof(frame))
+        {
+            position = written;
+            break;
+        }
+        sSharedRingRecord record;
+        record.m_time = frame.m_time;
+        record.m_type = static_cast<eLogMsgType>(frame.m_type);
+        record.m_text.resize(frame.m_size);
+        CopyOut(m_data, mask, position + sizeof(frame), &record.m_text[0], frame.m_size);
+        records.push_back(std::move(record));
+        position += sizeof(frame) + frame.m_size;
+        ++count;
+    }
+    m_header->m_read.store(position, std::memory_order_release);
+    return count;
+}
+
+bool sSharedRingReader::isFinished() const
+{
+    if (m_header->m_isClosed.load(std::memory_order_acquire) != 0)
+        return true;
+#ifndef _WIN32
+    return ::kill(static_cast<pid_t>(m_header->m_processID), 0) != 0 && errno == ESRCH;
+#else
+    return false;
+#endif
+}
+
+uint64_t sSharedRingReader::processID() const
+{
+    return m_header->m_processID;
+}
+
+uint64_t sSharedRingReader::dropped() const
+{
+    return m_header->m_dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file SharedRing.h
+ * @brief Shared-memory record rings of several processes, drained by the logcollect tool.
+ *
+ * Every process maps its own ring file "<directory>/<process ID>.ring", preferably on a
+ * memory file system such as /dev/shm. The process is the only producer of its ring and the
+ * collector the only consumer, so a record is published with one release store and needs no
+ * system call. The ring outlives its process: the records a crashed process had published
+ * are still drained by the collector.
+ */
+
+#pragma once
+
+#include "LogRecord.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Extension of the ring files.
+ */
+inline constexpr char SharedRingExtension[] = ".ring";
+
+/**
+ * @brief Start of a ring file, the record bytes follow it.
+ * @note The producer and the collector update their positions on separate cache lines.
+ */
+struct sSharedRingHeader
+{
+    char m_signature[4];
+    uint32_t m_version;
+    uint64_t m_capacity;                    //!< Size of the byte ring, a power of two
+    uint64_t m_processID;
+    std::atomic<uint32_t> m_isClosed;       //!< Set when the producer closed the ring on purpose
+    alignas(64) std::atomic<uint64_t> m_written;  //!< Bytes ever published, written by the producer
+    std::atomic<uint64_t> m_dropped;        //!< Records that did not fit into the ring
+    alignas(64) std::atomic<uint64_t> m_read;     //!< Bytes ever consumed, written by the collector
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the positions are shared between processes");
+
+/**
+ * @brief A record read from a ring.
+ */
+struct sSharedRingRecord
+{
+    int64_t m_time = 0;     //!< Microseconds since the Unix epoch
+    eLogMsgType m_type = eLogMsgType::None;
+    std::string m_text;     //!< Plain text of the record, with its line feed
+};
+
+/**
+ * @brief The ring of the current process.
+ */
+struct sSharedRingWriter
+{
+    ~sSharedRingWriter();
+
+    sSharedRingWriter(const sSharedRingWriter&) = delete;
+    sSharedRingWriter& operator=(const sSharedRingWriter&) = delete;
+
+    /**
+     * @brief Publishes a record, or counts it as dropped if the collector is behind.
+     * @return false if the record was dropped.
+     * @note Must not be called by two threads at a time.
+     */
+    bool write(int64_t time, eLogMsgType type, std::string_view text);
+
+private:
+    friend std::unique_ptr<sSharedRingWriter> CreateSharedRing(const std::string& directory, size_t capacity);
+
+    sSharedRingWriter(sSharedRingHeader* header, size_t mappedSize);
+
+    sSharedRingHeader* m_header;
+    char* m_data;
+    size_t m_mappedSize;
+    uint64_t m_mask;
+    uint64_t m_readCache = 0;   //!< Last known read position, the shared one is loaded only when the ring looks full
+};
+
+/**
+ * @brief Creates the ring of the current process in the directory.
+ * @param capacity Size of the ring in bytes, rounded up to a power of two.
+ * @return nullptr if the ring cannot be created or the system has no shared mappings.
+ */
+std::unique_ptr<sSharedRingWriter> CreateSharedRing(const std::string& directory, size_t capacity);
+
+/**
+ * @brief The collector side of a ring file.
+ */
+struct sSharedRingReader
+{
+    /**
+     * @brief Maps the ring file, isOpen() tells whether it is a ring.
+     */
+    explicit sSharedRingReader(const std::string& path);
+    ~sSharedRingReader();
+
+    sSharedRingReader(const sSharedRingReader&) = delete;
+    sSharedRingReader& operator=(const sSharedRingReader&) = delete;
+
+    bool isOpen() const
+    {
+        return m_header != nullptr;
+    }
+
+    /**
+     * @brief Appends the published records to the vector and frees their space in the ring.
+     * @return The number of records read.
+     */
+    size_t read(std::vector<sSharedRingRecord>& records);
+
+    /**
+     * @brief Returns true if the producer closed the ring or does not run any more.
+     * @note Read the ring after this returned true, to get the last records.
+     */
+    bool isFinished() const;
+
+    uint64_t processID() const;
+    uint64_t dropped() const;
+
+private:
+    sSharedRingHeader* m_header = nullptr;
+    const char* m_data = nullptr;
+    size_t m_mappedSize = 0;
+};
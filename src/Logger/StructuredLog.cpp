@@ -0,0 +1,111 @@
+#include "StructuredLog.h"
+#include "LogFormatCore.h"
+
+#include <cmath>
+
+namespace
+{
+    const char HexDigits[] = "0123456789abcdef";
+
+    bool NeedsJsonEscape(unsigned char c)
+    {
+        return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    void AppendJsonString(std::string& out, std::string_view value)
+    {
+        out.push_back('"');
+        size_t runStart = 0;
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            const auto c = static_cast<unsigned char>(value[i]);
+            if (!NeedsJsonEscape(c))
+                continue;
+            out.append(value.data() + runStart, i - runStart);
+            runStart = i + 1;
+            switch (c)
+            {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                {
+                    const char escape[] = { '\\', 'u', '0', '0', HexDigits[c >> 4], HexDigits[c & 0xF] };
+                    out.append(escape, sizeof(escape));
+                }
+                break;
+            }
+        }
+        out.append(value.data() + runStart, value.size() - runStart);
+        out.push_back('"');
+    }
+
+    void AppendLogfmtString(std::string& out, std::string_view value)
+    {
+        bool needsQuotes = value.empty();
+        for (const char c : value)
+        {
+            if (static_cast<unsigned char>(c) <= ' ' || c == '=' || c == '"' || c == '\\')
+            {
+                needsQuotes = true;
+                break;
+            }
+        }
+        if (!needsQuotes)
+            out.append(value.data(), value.size());
+        else
+            AppendJsonString(out, value);
+    }
+}
+
+void AppendFieldKey(std::string& out, eLogLayout layout, size_t recordStart, std::string_view key)
+{
+    if (layout == eLogLayout::Json)
+    {
+        if (out.size() > recordStart + 1)
+            out.push_back(',');
+        AppendJsonString(out, key);
+        out.push_back(':');
+        return;
+    }
+    if (out.size() > recordStart)
+        out.push_back(' ');
+    out.append(key.data(), key.size());
+    out.push_back('=');
+}
+
+void AppendStringValue(std::string& out, eLogLayout layout, std::string_view value)
+{
+    if (layout == eLogLayout::Json)
+        AppendJsonString(out, value);
+    else
+        AppendLogfmtString(out, value);
+}
+
+void AppendFieldValue(std::string& out, eLogLayout layout, const sLogField& field)
+{
+    switch (field.m_type)
+    {
+    case sLogField::eType::Int:
+        AppendInteger(out, field.m_int);
+        break;
+    case sLogField::eType::UInt:
+        AppendInteger(out, field.m_uint);
+        break;
+    case sLogField::eType::Double:
+        // JSON has no literals for NaN and the infinities.
+        if (layout == eLogLayout::Json && !std::isfinite(field.m_double))
+            out.append("null");
+        else
+            AppendShortest(out, field.m_double);
+        break;
+    case sLogField::eType::Bool:
+        out.append(field.m_bool ? "true" : "false");
+        break;
+    case sLogField::eType::String:
+        AppendStringValue(out, layout, field.m_string);
+        break;
+    }
+}
@@ -0,0 +1,30 @@
+/**
+ * @file StructuredLog.h
+ * @brief Encoders of the JSON lines and logfmt record layouts.
+ */
+
+#pragma once
+
+#include "LogFields.h"
+#include "Logger.h"
+
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Appends the separator and the key of the next field: ,"key": in JSON, " key=" in
+ * logfmt and in the text layout.
+ * @param recordStart Offset of the record in out, no separator is needed right after it.
+ */
+void AppendFieldKey(std::string& out, eLogLayout layout, size_t recordStart, std::string_view key);
+
+/**
+ * @brief Appends a string value: a JSON string, or a logfmt value quoted only when it has to be.
+ * @note Runs of characters that need no escaping are copied at once.
+ */
+void AppendStringValue(std::string& out, eLogLayout layout, std::string_view value);
+
+/**
+ * @brief Appends the value of the field, numbers and booleans unquoted.
+ */
+void AppendFieldValue(std::string& out, eLogLayout layout, const sLogField& field);
@@ -0,0 +1,147 @@
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+#define TELEMETRY_COUNTERS static_cast<size_t>(eTelemetryCounter::Count)
+
+    using Totals = std::array<uint64_t, TELEMETRY_COUNTERS>;
+
+    // Written by its thread only. The counters are atomic so the sum can read them while
+    // the thread runs, but an update is a plain load and store.
+    struct sTelemetryShard
+    {
+        std::array<std::atomic<uint64_t>, TELEMETRY_COUNTERS> m_values{};
+    };
+
+    // Shards of the running threads. A finished thread adds its shard to the retired totals,
+    // so its records stay counted. A reset moves the baseline instead of touching the shards
+    // of other threads. Never destroyed, a summary may run while static objects are destroyed.
+    struct sTelemetryRegistry
+    {
+        std::mutex m_mtx;
+        std::vector<std::unique_ptr<sTelemetryShard>> m_shards;
+        Totals m_retired{};
+        Totals m_baseline{};
+    };
+
+    std::atomic<bool> g_isTelemetryOn{ false };
+
+    sTelemetryRegistry& Registry()
+    {
+        static sTelemetryRegistry* registry = new sTelemetryRegistry;
+        return *registry;
+    }
+
+    // The registry keeps the shard alive. A plain pointer is constant-initialized, so reading
+    // it needs no guard of a dynamically initialized thread_local.
+    thread_local sTelemetryShard* t_shard = nullptr;
+
+    // Retires the shard of its thread when the thread ends. Only touched when the shard is
+    // registered, so counting never goes through the guard of this thread_local.
+    struct sTelemetryShardHolder
+    {
+        ~sTelemetryShardHolder()
+        {
+            if (!t_shard)
+                return;
+            sTelemetryRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.m_mtx);
+            for (size_t i = 0; i < TELEMETRY_COUNTERS; ++i)
+                registry.m_retired[i] += t_shard->m_values[i].load(std::memory_order_relaxed);
+            registry.m_shards.erase(std::find_if(registry.m_shards.begin(), registry.m_shards.end(),
+                [](const std::unique_ptr<sTelemetryShard>& shard) { return shard.get() == t_shard; }));
+            t_shard = nullptr;
+        }
+    };
+
+    thread_local sTelemetryShardHolder t_shardHolder;
+
+    sTelemetryShard* RegisterCurrentThread()
+    {
+        auto upShard = std::make_unique<sTelemetryShard>();
+        sTelemetryShard* shard = upShard.get();
+        sTelemetryRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.m_mtx);
+        registry.m_shards.push_back(std::move(upShard));
+        return shard;
+    }
+
+    sTelemetryShard& CurrentShard()
+    {
+        if (!t_shard)
+        {
+            t_shard = RegisterCurrentThread();
+            // Odr-use of the holder schedules its destructor at the end of the thread.
+            (void)&t_shardHolder;
+        }
+        return *t_shard;
+    }
+
+    uint64_t Value(const Totals& totals, eTelemetryCounter counter)
+    {
+        return totals[static_cast<size_t>(counter)];
+    }
+}
+
+void SetTelemetry(bool isEnabled)
+{
+    g_isTelemetryOn.store(isEnabled, std::memory_order_relaxed);
+}
+
+bool IsTelemetryOn()
+{
+    return g_isTelemetryOn.load(std::memory_order_relaxed);
+}
+
+void CountTelemetry(eTelemetryCounter counter, uint64_t value)
+{
+    if (!IsTelemetryOn())
+        return;
+    std::atomic<uint64_t>& slot = CurrentShard().m_values[static_cast<size_t>(counter)];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void CountTelemetryRecord(eLogMsgType type)
+{
+    CountTelemetry(static_cast<eTelemetryCounter>(static_cast<size_t>(eTelemetryCounter::RecordsNone) + static_cast<size_t>(type)));
+}
+
+sLogTelemetry CollectTelemetry(bool reset)
+{
+    sTelemetryRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.m_mtx);
+    Totals totals = registry.m_retired;
+    for (const std::unique_ptr<sTelemetryShard>& shard : registry.m_shards)
+    {
+        for (size_t i = 0; i < TELEMETRY_COUNTERS; ++i)
+            totals[i] += shard->m_values[i].load(std::memory_order_relaxed);
+    }
+    const Totals baseline = registry.m_baseline;
+    if (reset)
+        registry.m_baseline = totals;
+    for (size_t i = 0; i < TELEMETRY_COUNTERS; ++i)
+        totals[i] -= baseline[i];
+
+    sLogTelemetry telemetry;
+    for (size_t i = 0; i < telemetry.m_records.size(); ++i)
+        telemetry.m_records[i] = totals[static_cast<size_t>(eTelemetryCounter::RecordsNone) + i];
+    telemetry.m_coutBytes = Value(totals, eTelemetryCounter::CoutBytes);
+    telemetry.m_cerrBytes = Value(totals, eTelemetryCounter::CerrBytes);
+    telemetry.m_fileBytes = Value(totals, eTelemetryCounter::FileBytes);
+    telemetry.m_threadFileBytes = Value(totals, eTelemetryCounter::ThreadFileBytes);
+    telemetry.m_fileWrites = Value(totals, eTelemetryCounter::FileWrites);
+    telemetry.m_fileWriteNs = Value(totals, eTelemetryCounter::FileWriteNs);
+    telemetry.m_fileSyncs = Value(totals, eTelemetryCounter::FileSyncs);
+    telemetry.m_lockWaits = Value(totals, eTelemetryCounter::LockWaits);
+    telemetry.m_lockWaitNs = Value(totals, eTelemetryCounter::LockWaitNs);
+    telemetry.m_dropped = Value(totals, eTelemetryCounter::Dropped);
+    telemetry.m_suppressed = Value(totals, eTelemetryCounter::Suppressed);
+    return telemetry;
+}
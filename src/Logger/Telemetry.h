@@ -0,0 +1,64 @@
+/**
+ * @file Telemetry.h
+ * @brief Counters of the logger itself: records, bytes per output, lock waits and file writes.
+ */
+
+#pragma once
+
+#include "Logger.h"
+
+#include <cstdint>
+
+/**
+ * @brief A counter of sLogTelemetry.
+ */
+enum class eTelemetryCounter : uint8_t
+{
+    // Records per eLogMsgType, in its order.
+    RecordsNone,
+    RecordsTrace,
+    RecordsDebug,
+    RecordsInfo,
+    RecordsWarning,
+    RecordsError,
+    CoutBytes,
+    CerrBytes,
+    FileBytes,
+    ThreadFileBytes,
+    FileWrites,
+    FileWriteNs,
+    FileSyncs,
+    LockWaits,
+    LockWaitNs,
+    Dropped,
+    Suppressed,
+    Count
+};
+
+/**
+ * @brief Turns the counting on or off. The counters keep their values while it is off.
+ */
+void SetTelemetry(bool isEnabled);
+
+/**
+ * @brief Returns true if the counters are being updated.
+ */
+bool IsTelemetryOn();
+
+/**
+ * @brief Adds the value to a counter of the current thread, if the counting is on.
+ * @note Every thread updates its own shard of the counters without atomic read-modify-write
+ * operations, the shards are only summed by CollectTelemetry.
+ */
+void CountTelemetry(eTelemetryCounter counter, uint64_t value = 1);
+
+/**
+ * @brief Counts a record of the given type.
+ */
+void CountTelemetryRecord(eLogMsgType type);
+
+/**
+ * @brief Sums the counters of all threads.
+ * @param reset Whether the counters start over from zero.
+ */
+sLogTelemetry CollectTelemetry(bool reset);
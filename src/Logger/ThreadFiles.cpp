@@ -0,0 +1,166 @@
+#include "ThreadFiles.h"
+#include "FastClock.h"
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct sThreadFileSettings
+    {
+        std::mutex m_mtx;
+        std::string m_path;
+        eFileSinkKind m_kind = eFileSinkKind::Stream;
+        bool m_isBinary = false;
+        sBinaryLogEncoder::ThreadNameFunc m_threadName = nullptr;
+    };
+
+    // Never destroyed, threads may still log while static objects are destroyed.
+    sThreadFileSettings& Settings()
+    {
+        static sThreadFileSettings* settings = new sThreadFileSettings;
+        return *settings;
+    }
+
+    struct sThreadFile
+    {
+        std::mutex m_mtx;
+        bool m_isOpened = false;   //!< Opening was tried with the current settings
+        bool m_isBinary = false;
+        std::unique_ptr<sFileSink> m_upSink;
+        std::unique_ptr<sBinaryLogEncoder> m_upEncoder;
+        std::string m_buffer;
+
+        void close()
+        {
+            m_upSink.reset();
+            m_upEncoder.reset();
+            m_isOpened = false;
+        }
+
+        void open(uint32_t threadIndex)
+        {
+            m_isOpened = true;
+            sThreadFileSettings& settings = Settings();
+            std::lock_guard<std::mutex> lock(settings.m_mtx);
+            if (settings.m_path.empty())
+                return;
+            m_upSink = CreateFileSink(settings.m_kind, ThreadFilePath(settings.m_path, threadIndex));
+            m_isBinary = settings.m_isBinary;
+            if (m_isBinary)
+                m_upEncoder = std::make_unique<sBinaryLogEncoder>(settings.m_threadName);
+        }
+    };
+
+    // Files of the running threads. Never destroyed, like the settings.
+    struct sThreadFileRegistry
+    {
+        std::mutex m_mtx;
+        std::vector<sThreadFile*> m_files;
+    };
+
+    sThreadFileRegistry& Registry()
+    {
+        static sThreadFileRegistry* registry = new sThreadFileRegistry;
+        return *registry;
+    }
+
+    // Registers the file of the thread for its lifetime, the file is closed when the thread exits.
+    struct sThreadFileHolder
+    {
+        sThreadFile m_file;
+
+        sThreadFileHolder()
+        {
+            sThreadFileRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.m_mtx);
+            registry.m_files.push_back(&m_file);
+        }
+
+        ~sThreadFileHolder()
+        {
+            sThreadFileRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.m_mtx);
+            registry.m_files.erase(std::remove(registry.m_files.begin(), registry.m_files.end(), &m_file), registry.m_files.end());
+        }
+    };
+
+    sThreadFile& CurrentThreadFile()
+    {
+        thread_local sThreadFileHolder holder;
+        return holder.m_file;
+    }
+}
+
+std::string ThreadFilePath(const std::string& path, uint32_t threadIndex)
+{
+    std::string result = path;
+    const auto pos = result.find_last_of("/\\");
+    result.insert(pos == std::string::npos ? 0 : pos + 1, std::to_string(threadIndex) + "_");
+    return result;
+}
+
+void ConfigureThreadFiles(const std::string& path, eFileSinkKind kind, bool isBinary,
+    sBinaryLogEncoder::ThreadNameFunc threadName)
+{
+    {
+        sThreadFileSettings& settings = Settings();
+        std::lock_guard<std::mutex> lock(settings.m_mtx);
+        settings.m_path = path;
+        settings.m_kind = kind;
+        settings.m_isBinary = isBinary;
+        settings.m_threadName = threadName;
+    }
+
+    sThreadFileRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.m_mtx);
+    for (sThreadFile* file : registry.m_files)
+    {
+        std::lock_guard<std::mutex> fileLock(file->m_mtx);
+        file->close();
+    }
+}
+
+void WriteThreadFile(const sLogRecord& record)
+{
+    sThreadFile& file = CurrentThreadFile();
+    std::lock_guard<std::mutex> lock(file.m_mtx);
+    if (!file.m_isOpened)
+        file.open(record.m_threadIndex);
+    if (!file.m_upSink)
+        return;
+
+    const std::string* text = &record.m_plain;
+    if (file.m_isBinary)
+    {
+        file.m_buffer.clear();
+        file.m_upEncoder->encode(record, file.m_buffer);
+        text = &file.m_buffer;
+    }
+    if (!IsTelemetryOn())
+    {
+        file.m_upSink->write(text->data(), text->size());
+        return;
+    }
+
+    const uint64_t start = ClockTicks();
+    file.m_upSink->write(text->data(), text->size());
+    CountTelemetry(eTelemetryCounter::FileWriteNs, ElapsedNanoseconds(start, ClockTicks()));
+    CountTelemetry(eTelemetryCounter::FileWrites);
+    CountTelemetry(eTelemetryCounter::ThreadFileBytes, text->size());
+}
+
+void FlushThreadFiles()
+{
+    sThreadFileRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.m_mtx);
+    for (sThreadFile* file : registry.m_files)
+    {
+        std::lock_guard<std::mutex> fileLock(file->m_mtx);
+        if (file->m_upSink)
+            file->m_upSink->flush();
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * @file ThreadFiles.h
+ * @brief Per-thread log files (eLogSettings::PerThreadFiles), written without the logger lock.
+ */
+
+#pragma once
+
+#include "BinaryLog.h"
+#include "FileSinks.h"
+#include "LogRecord.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Returns the path of the file of a thread: the thread index and an underscore
+ * are put in front of the file name, e.g. "logs/3_log.txt".
+ */
+std::string ThreadFilePath(const std::string& path, uint32_t threadIndex);
+
+/**
+ * @brief Sets the files every thread writes to and closes the files opened so far.
+ * @param path The log file path the thread files are derived from, empty to write no files.
+ * @note Every thread opens its file with these settings on its next record.
+ */
+void ConfigureThreadFiles(const std::string& path, eFileSinkKind kind, bool isBinary,
+    sBinaryLogEncoder::ThreadNameFunc threadName);
+
+/**
+ * @brief Appends the record to the file of the current thread.
+ * @note Every thread has its own file and lock, the lock is only contended while
+ * FlushThreadFiles or ConfigureThreadFiles runs.
+ */
+void WriteThreadFile(const sLogRecord& record);
+
+/**
+ * @brief Hands the buffered data of every thread file over to the operating system.
+ */
+void FlushThreadFiles();
@@ -0,0 +1,149 @@
+#include "TimerStats.h"
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace
+{
+    struct sLabelHistogram
+    {
+        std::string m_label;
+        sLatencyHistogram m_histogram;
+    };
+
+    struct sThreadTimerStats
+    {
+        std::mutex m_mtx;
+        std::vector<std::unique_ptr<sLabelHistogram>> m_labels;
+        sLabelHistogram* m_last = nullptr;   //!< Most recently used label, checked first
+    };
+
+    using HistogramMap = std::map<std::string, std::unique_ptr<sLatencyHistogram>>;
+
+    // Statistics of every running thread that recorded a sample. A finished thread merges its
+    // histograms into the retired ones, so its samples are still reported. Never destroyed,
+    // a report may run while static objects are destroyed.
+    struct sTimerStatsRegistry
+    {
+        std::mutex m_mtx;
+        std::vector<std::unique_ptr<sThreadTimerStats>> m_threads;
+        HistogramMap m_retired;
+    };
+
+    sTimerStatsRegistry& Registry()
+    {
+        static sTimerStatsRegistry* registry = new sTimerStatsRegistry;
+        return *registry;
+    }
+
+    void MergeHistogram(HistogramMap& merged, const std::string& label, const sLatencyHistogram& histogram)
+    {
+        auto& upHistogram = merged[label];
+        if (!upHistogram)
+            upHistogram = std::make_unique<sLatencyHistogram>();
+        upHistogram->merge(histogram);
+    }
+
+    // Registers the statistics of its thread and retires them when the thread ends.
+    struct sThreadTimerStatsHolder
+    {
+        sThreadTimerStatsHolder()
+        {
+            auto upStats = std::make_unique<sThreadTimerStats>();
+            m_stats = upStats.get();
+            sTimerStatsRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.m_mtx);
+            registry.m_threads.push_back(std::move(upStats));
+        }
+
+        ~sThreadTimerStatsHolder()
+        {
+            sTimerStatsRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.m_mtx);
+            for (const auto& entry : m_stats->m_labels)
+            {
+                if (entry->m_histogram.m_count > 0)
+                    MergeHistogram(registry.m_retired, entry->m_label, entry->m_histogram);
+            }
+            registry.m_threads.erase(std::find_if(registry.m_threads.begin(), registry.m_threads.end(),
+                [this](const std::unique_ptr<sThreadTimerStats>& item) { return item.get() == m_stats; }));
+        }
+
+        sThreadTimerStats* m_stats;
+    };
+
+    sThreadTimerStats& CurrentThreadStats()
+    {
+        thread_local sThreadTimerStatsHolder holder;
+        return *holder.m_stats;
+    }
+}
+
+void RecordTimerSample(std::string_view label, uint64_t ns)
+{
+    sThreadTimerStats& stats = CurrentThreadStats();
+    std::lock_guard<std::mutex> lock(stats.m_mtx);
+
+    sLabelHistogram* entry = stats.m_last;
+    if (!entry || entry->m_label != label)
+    {
+        auto it = std::find_if(stats.m_labels.begin(), stats.m_labels.end(),
+            [label](const std::unique_ptr<sLabelHistogram>& item) { return item->m_label == label; });
+        if (it == stats.m_labels.end())
+        {
+            stats.m_labels.push_back(std::make_unique<sLabelHistogram>());
+            stats.m_labels.back()->m_label.assign(label.data(), label.size());
+            it = stats.m_labels.end() - 1;
+        }
+        entry = it->get();
+        stats.m_last = entry;
+    }
+    entry->m_histogram.record(ns);
+}
+
+std::vector<sLogTimerStats> CollectTimerStats(bool reset)
+{
+    HistogramMap merged;
+    {
+        // Held throughout, so a thread that ends meanwhile is counted exactly once.
+        sTimerStatsRegistry& registry = Registry();
+        std::lock_guard<std::mutex> registryLock(registry.m_mtx);
+        for (const auto& thread : registry.m_threads)
+        {
+            std::lock_guard<std::mutex> lock(thread->m_mtx);
+            for (const auto& entry : thread->m_labels)
+            {
+                if (entry->m_histogram.m_count == 0)
+                    continue;
+                MergeHistogram(merged, entry->m_label, entry->m_histogram);
+                if (reset)
+                    entry->m_histogram.reset();
+            }
+        }
+        for (const auto& item : registry.m_retired)
+            MergeHistogram(merged, item.first, *item.second);
+        if (reset)
+            registry.m_retired.clear();
+    }
+
+    std::vector<sLogTimerStats> result;
+    result.reserve(merged.size());
+    for (const auto& item : merged)
+    {
+        const sLatencyHistogram& histogram = *item.second;
+        sLogTimerStats stats;
+        stats.m_label = item.first;
+        stats.m_count = histogram.m_count;
+        stats.m_minNs = histogram.m_min;
+        stats.m_meanNs = histogram.mean();
+        stats.m_p50Ns = histogram.percentile(0.5);
+        stats.m_p99Ns = histogram.percentile(0.99);
+        stats.m_maxNs = histogram.m_max;
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
@@ -0,0 +1,25 @@
+/**
+ * @file TimerStats.h
+ * @brief Per-thread aggregation of named timers.
+ */
+
+#pragma once
+
+#include "Logger.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Adds a duration to the histogram of the label on the current thread.
+ * @note Every thread fills its own histograms, the lock they carry is only contended
+ * while CollectTimerStats merges them.
+ */
+void RecordTimerSample(std::string_view label, uint64_t ns);
+
+/**
+ * @brief Merges the histograms of all threads into statistics per label, sorted by label.
+ * @param reset Whether the histograms start over after being collected.
+ */
+std::vector<sLogTimerStats> CollectTimerStats(bool reset);
@@ -0,0 +1,111 @@
+/**
+ * @file LogArgs.h
+ * @brief Compact binary capture of printf-style arguments and their later formatting.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Type tag stored in front of every captured argument.
+ */
+enum class eLogArgType : uint8_t
+{
+    Int,        //!< int (and every integer type promoted to int)
+    UInt,       //!< unsigned int
+    Long,       //!< long
+    ULong,      //!< unsigned long
+    LongLong,   //!< long long
+    ULongLong,  //!< unsigned long long
+    Double,     //!< double (and float)
+    LongDouble, //!< long double
+    Pointer,    //!< Any pointer that is not a C string
+    String      //!< Owned copy of a C string or std::string
+};
+
+namespace LogArgsDetail
+{
+    template <typename T>
+    void AppendRaw(std::string& buffer, eLogArgType type, const T& value)
+    {
+        buffer.push_back(static_cast<char>(type));
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    inline void AppendString(std::string& buffer, const char* str, size_t size)
+    {
+        const auto size32 = static_cast<uint32_t>(size);
+        AppendRaw(buffer, eLogArgType::String, size32);
+        buffer.append(str, size);
+        buffer.push_back('\0');
+    }
+
+    inline void EncodeArg(std::string& buffer, int value) { AppendRaw(buffer, eLogArgType::Int, value); }
+    inline void EncodeArg(std::string& buffer, unsigned int value) { AppendRaw(buffer, eLogArgType::UInt, value); }
+    inline void EncodeArg(std::string& buffer, long value) { AppendRaw(buffer, eLogArgType::Long, value); }
+    inline void EncodeArg(std::string& buffer, unsigned long value) { AppendRaw(buffer, eLogArgType::ULong, value); }
+    inline void EncodeArg(std::string& buffer, long long value) { AppendRaw(buffer, eLogArgType::LongLong, value); }
+    inline void EncodeArg(std::string& buffer, unsigned long long value) { AppendRaw(buffer, eLogArgType::ULongLong, value); }
+    inline void EncodeArg(std::string& buffer, double value) { AppendRaw(buffer, eLogArgType::Double, value); }
+    inline void EncodeArg(std::string& buffer, float value) { EncodeArg(buffer, static_cast<double>(value)); }
+    inline void EncodeArg(std::string& buffer, long double value) { AppendRaw(buffer, eLogArgType::LongDouble, value); }
+
+    inline void EncodeArg(std::string& buffer, const char* value)
+    {
+        if (value)
+            AppendString(buffer, value, std::strlen(value));
+        else
+            AppendString(buffer, "(null)", 6);
+    }
+
+    inline void EncodeArg(std::string& buffer, char* value) { EncodeArg(buffer, static_cast<const char*>(value)); }
+    inline void EncodeArg(std::string& buffer, const std::string& value) { AppendString(buffer, value.data(), value.size()); }
+    inline void EncodeArg(std::string& buffer, std::string_view value) { AppendString(buffer, value.data(), value.size()); }
+    inline void EncodeArg(std::string& buffer, std::nullptr_t) { AppendRaw(buffer, eLogArgType::Pointer, static_cast<const void*>(nullptr)); }
+
+    template <typename T>
+    void EncodeArg(std::string& buffer, T* value)
+    {
+        AppendRaw(buffer, eLogArgType::Pointer, static_cast<const void*>(value));
+    }
+
+    // Integer types narrower than int, bool and enums follow the default argument promotions.
+    template <typename T, typename = std::enable_if_t<std::is_integral<T>::value || std::is_enum<T>::value>>
+    void EncodeArg(std::string& buffer, T value)
+    {
+        static_assert(sizeof(T) <= sizeof(int) || std::is_enum<T>::value, "Unsupported integer type");
+        EncodeArg(buffer, static_cast<int>(value));
+    }
+}
+
+/**
+ * @brief Appends the arguments to the buffer as tagged raw values.
+ * @note Strings are copied, so the buffer does not refer to the caller's memory.
+ */
+inline void EncodeLogArgs(std::string&)
+{
+}
+
+template <typename T, typename... Rest>
+void EncodeLogArgs(std::string& buffer, const T& first, const Rest&... rest)
+{
+    LogArgsDetail::EncodeArg(buffer, first);
+    EncodeLogArgs(buffer, rest...);
+}
+
+/**
+ * @brief Formats arguments captured by EncodeLogArgs according to a printf format string.
+ * @param format The printf format string.
+ * @param args Pointer to the captured arguments.
+ * @param size Size of the captured arguments in bytes.
+ * @param out The formatted text is appended to this string, without length limit.
+ * @note A conversion that does not fit the captured type is printed with the default
+ * conversion of that type instead of causing undefined behaviour. Conversions without an
+ * argument are copied as is, %n is ignored.
+ */
+void FormatLogArgs(const char* format, const char* args, size_t size, std::string& out);
@@ -0,0 +1,86 @@
+/**
+ * @file LogFields.h
+ * @brief Typed key/value fields of structured log records.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief A key with a number, boolean or string value.
+ * @note Keys and string values are views: a field only lives for the logging call it is
+ * passed to, e.g. Logger::printFields(eLogMsgType::Info, "done", {{"status", 200}, {"path", path}}).
+ */
+struct sLogField
+{
+    enum class eType : uint8_t
+    {
+        Int,
+        UInt,
+        Double,
+        Bool,
+        String
+    };
+
+    template <typename T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value, int> = 0>
+    sLogField(std::string_view key, T value)
+        : m_key(key)
+    {
+        if constexpr (std::is_signed<T>::value)
+        {
+            m_type = eType::Int;
+            m_int = static_cast<int64_t>(value);
+        }
+        else
+        {
+            m_type = eType::UInt;
+            m_uint = static_cast<uint64_t>(value);
+        }
+    }
+
+    sLogField(std::string_view key, double value)
+        : m_key(key)
+        , m_type(eType::Double)
+        , m_double(value)
+    {
+    }
+
+    sLogField(std::string_view key, bool value)
+        : m_key(key)
+        , m_type(eType::Bool)
+        , m_bool(value)
+    {
+    }
+
+    sLogField(std::string_view key, std::string_view value)
+        : m_key(key)
+        , m_type(eType::String)
+        , m_string(value)
+    {
+    }
+
+    sLogField(std::string_view key, const char* value)
+        : sLogField(key, std::string_view(value ? value : "(null)"))
+    {
+    }
+
+    sLogField(std::string_view key, const std::string& value)
+        : sLogField(key, std::string_view(value))
+    {
+    }
+
+    std::string_view m_key;
+    eType m_type = eType::Int;
+    union
+    {
+        int64_t m_int = 0;
+        uint64_t m_uint;
+        double m_double;
+        bool m_bool;
+    };
+    std::string_view m_string;
+};
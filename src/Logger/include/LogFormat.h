@@ -0,0 +1,502 @@
+/**
+ * @file LogFormat.h
+ * @brief printf-style format strings parsed and checked against the arguments at compile time.
+ */
+
+#pragma once
+
+#include "LogFormatCore.h"
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Base of the format string types created by LOG_FORMAT.
+ */
+struct sLogFormatString
+{
+};
+
+/**
+ * @brief Wraps a string literal into a type, so the format can be parsed at compile time.
+ * @note Usage: Logger::print(eLogMsgType::Info, LOG_FORMAT("value %d"), value);
+ */
+#define LOG_FORMAT(str) \
+    [] { \
+        struct sFormat : sLogFormatString \
+        { \
+            static constexpr const char* value() { return str; } \
+        }; \
+        return sFormat{}; \
+    }()
+
+namespace LogFormatDetail
+{
+    /**
+     * @brief Expected kind of an argument.
+     */
+    enum class eArgKind : uint8_t
+    {
+        Integer,
+        Float,
+        String,
+        Pointer
+    };
+
+    /**
+     * @brief A literal chunk or a conversion of the format string.
+     */
+    struct sToken
+    {
+        bool m_isArg = false;
+        size_t m_begin = 0;     //!< Literal: start of the chunk. Conversion: position of '%'.
+        size_t m_length = 0;    //!< Literal: length of the chunk.
+        size_t m_specEnd = 0;   //!< Conversion: end of flags, width and precision.
+        size_t m_stars = 0;     //!< Conversion: number of '*' taking an int argument.
+        size_t m_firstArg = 0;  //!< Conversion: index of the first consumed argument.
+        bool m_isPlain = false; //!< Conversion: no flags, width, precision or length modifier changing the value.
+        char m_conv = 0;        //!< Conversion: the conversion character.
+    };
+
+    constexpr bool Contains(const char* chars, char c)
+    {
+        for (; *chars; ++chars)
+        {
+            if (*chars == c)
+                return true;
+        }
+        return false;
+    }
+
+    constexpr bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    constexpr eArgKind KindOf(char conv)
+    {
+        if (Contains("fFeEgGaA", conv))
+            return eArgKind::Float;
+        if (conv == 's')
+            return eArgKind::String;
+        if (conv == 'p')
+            return eArgKind::Pointer;
+        return eArgKind::Integer;
+    }
+
+    /**
+     * @brief Splits the format into tokens.
+     * @param tokens Output array, nullptr to only count the tokens.
+     * @param isValid Set to false if the format contains an unknown or unsupported conversion.
+     * @return The number of tokens.
+     */
+    constexpr size_t Parse(const char* format, sToken* tokens, bool& isValid)
+    {
+        size_t count = 0;
+        size_t argsNum = 0;
+        size_t pos = 0;
+        size_t literalBegin = 0;
+        auto addLiteral = [&](size_t end) {
+            if (end > literalBegin)
+            {
+                if (tokens)
+                {
+                    tokens[count].m_begin = literalBegin;
+                    tokens[count].m_length = end - literalBegin;
+                }
+                ++count;
+            }
+        };
+
+        while (format[pos])
+        {
+            if (format[pos] != '%')
+            {
+                ++pos;
+                continue;
+            }
+            if (format[pos + 1] == '%')
+            {
+                // The chunk keeps the first '%' and skips the second one.
+                addLiteral(pos + 1);
+                pos += 2;
+                literalBegin = pos;
+                continue;
+            }
+
+            addLiteral(pos);
+            sToken token;
+            token.m_isArg = true;
+            token.m_begin = pos++;
+            token.m_isPlain = true;
+            while (format[pos] && Contains("-+ #0", format[pos]))
+            {
+                token.m_isPlain = false;
+                ++pos;
+            }
+            for (int part = 0; part < 2; ++part)
+            {
+                if (part == 1)
+                {
+                    if (format[pos] != '.')
+                        break;
+                    token.m_isPlain = false;
+                    ++pos;
+                }
+                if (format[pos] == '*')
+                {
+                    token.m_isPlain = false;
+                    ++token.m_stars;
+                    ++pos;
+                }
+                while (IsDigit(format[pos]))
+                {
+                    token.m_isPlain = false;
+                    ++pos;
+                }
+            }
+            token.m_specEnd = pos;
+            // l, ll, j, z and t only give the size of an integer, the argument type is known anyway.
+            bool hasSize = false;
+            while (format[pos] && Contains("hljztL", format[pos]))
+            {
+                if (Contains("hL", format[pos]))
+                    token.m_isPlain = false;
+                hasSize = true;
+                ++pos;
+            }
+
+            token.m_conv = format[pos];
+            if (!token.m_conv || !Contains("diouxXcfFeEgGaAsp", token.m_conv))
+            {
+                isValid = false;
+                return count;
+            }
+            if (hasSize && !Contains("diouxX", token.m_conv))
+                token.m_isPlain = false;
+            ++pos;
+
+            token.m_firstArg = argsNum;
+            argsNum += token.m_stars + 1;
+            if (tokens)
+                tokens[count] = token;
+            ++count;
+            literalBegin = pos;
+        }
+        addLiteral(pos);
+        return count;
+    }
+
+    template <typename Fmt>
+    constexpr size_t TokensCount()
+    {
+        bool isValid = true;
+        return Parse(Fmt::value(), nullptr, isValid);
+    }
+
+    template <typename Fmt>
+    constexpr bool IsValid()
+    {
+        bool isValid = true;
+        Parse(Fmt::value(), nullptr, isValid);
+        return isValid;
+    }
+
+    template <typename Fmt>
+    constexpr std::array<sToken, TokensCount<Fmt>()> Tokens()
+    {
+        std::array<sToken, TokensCount<Fmt>()> tokens{};
+        bool isValid = true;
+        if constexpr (TokensCount<Fmt>() > 0)
+            Parse(Fmt::value(), &tokens[0], isValid);
+        return tokens;
+    }
+
+    template <typename Fmt>
+    constexpr size_t ArgsCount()
+    {
+        size_t count = 0;
+        for (const sToken& token : Tokens<Fmt>())
+        {
+            if (token.m_isArg)
+                count += token.m_stars + 1;
+        }
+        return count;
+    }
+
+    template <typename Fmt>
+    constexpr std::array<eArgKind, ArgsCount<Fmt>()> ArgKinds()
+    {
+        std::array<eArgKind, ArgsCount<Fmt>()> kinds{};
+        size_t arg = 0;
+        for (const sToken& token : Tokens<Fmt>())
+        {
+            if (!token.m_isArg)
+                continue;
+            for (size_t i = 0; i < token.m_stars; ++i)
+                kinds[arg++] = eArgKind::Integer;
+            kinds[arg++] = KindOf(token.m_conv);
+        }
+        return kinds;
+    }
+
+    template <typename T>
+    constexpr bool IsString()
+    {
+        using U = std::decay_t<T>;
+        return std::is_same<U, const char*>::value || std::is_same<U, char*>::value
+            || std::is_same<U, std::string>::value || std::is_same<U, std::string_view>::value;
+    }
+
+    template <typename T>
+    constexpr bool Accepts(eArgKind kind)
+    {
+        using U = std::decay_t<T>;
+        switch (kind)
+        {
+        case eArgKind::Integer:
+            return std::is_integral<U>::value || std::is_enum<U>::value;
+        case eArgKind::Float:
+            return std::is_floating_point<U>::value;
+        case eArgKind::String:
+            return IsString<T>();
+        case eArgKind::Pointer:
+            return std::is_pointer<U>::value || std::is_same<U, std::nullptr_t>::value;
+        }
+        return false;
+    }
+
+    template <typename Fmt, typename... Args, size_t... I>
+    constexpr bool ArgsMatchImpl(std::index_sequence<I...>)
+    {
+        constexpr auto kinds = ArgKinds<Fmt>();
+        const bool matches[] = { true, Accepts<Args>(kinds[I])... };
+        for (bool match : matches)
+        {
+            if (!match)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns true if every argument fits its conversion.
+     */
+    template <typename Fmt, typename... Args>
+    constexpr bool ArgsMatch()
+    {
+        if constexpr (ArgsCount<Fmt>() != sizeof...(Args))
+            return false;
+        else
+            return ArgsMatchImpl<Fmt, Args...>(std::index_sequence_for<Args...>{});
+    }
+
+    /**
+     * @brief Applies the default argument promotions of printf.
+     */
+    template <typename T>
+    auto Promote(const T& value)
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_enum<U>::value)
+            return Promote(static_cast<std::underlying_type_t<U>>(value));
+        else if constexpr (std::is_integral<U>::value && sizeof(U) < sizeof(int))
+            return static_cast<int>(value);
+        else if constexpr (std::is_same<U, float>::value)
+            return static_cast<double>(value);
+        else if constexpr (std::is_same<U, std::string>::value)
+            return value.c_str();
+        else if constexpr (IsString<U>())
+            return static_cast<const char*>(value);
+        else if constexpr (std::is_pointer<U>::value && !IsString<U>())
+            return static_cast<const void*>(value);
+        else if constexpr (std::is_same<U, std::nullptr_t>::value)
+            return static_cast<const void*>(nullptr);
+        else
+            return static_cast<U>(value);
+    }
+
+    template <typename P>
+    constexpr const char* LengthModifier(char conv)
+    {
+        if (conv == 'c' || conv == 's' || conv == 'p')
+            return "";
+        if (std::is_same<P, long>::value || std::is_same<P, unsigned long>::value)
+            return "l";
+        if (std::is_same<P, long long>::value || std::is_same<P, unsigned long long>::value)
+            return "ll";
+        if (std::is_same<P, long double>::value)
+            return "L";
+        return "";
+    }
+
+    constexpr size_t MaxSpecSize = 48;
+
+    /**
+     * @brief Builds the snprintf specification of a conversion for the promoted argument type.
+     */
+    template <typename Fmt, size_t Tok, typename P>
+    constexpr std::array<char, MaxSpecSize> BuildSpec()
+    {
+        constexpr sToken token = Tokens<Fmt>()[Tok];
+        static_assert(token.m_specEnd - token.m_begin + 4 < MaxSpecSize, "Logger: conversion specification is too long");
+
+        std::array<char, MaxSpecSize> spec{};
+        size_t size = 0;
+        const char* format = Fmt::value();
+        for (size_t i = token.m_begin; i < token.m_specEnd; ++i)
+            spec[size++] = format[i];
+        for (const char* length = LengthModifier<P>(token.m_conv); *length; ++length)
+            spec[size++] = *length;
+        spec[size] = token.m_conv;
+        return spec;
+    }
+
+    template <typename... Values>
+    void AppendSnprintf(std::string& out, const char* spec, Values... values)
+    {
+        const size_t oldSize = out.size();
+        size_t room = 64;
+        for (;;)
+        {
+            out.resize(oldSize + room);
+            const int written = std::snprintf(&out[oldSize], room, spec, values...);
+            if (written < 0)
+            {
+                out.resize(oldSize);
+                return;
+            }
+            if (static_cast<size_t>(written) < room)
+            {
+                out.resize(oldSize + static_cast<size_t>(written));
+                return;
+            }
+            room = static_cast<size_t>(written) + 1;
+        }
+    }
+
+    template <typename Integer>
+    void AppendHex(std::string& out, Integer value)
+    {
+        char buffer[16];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, 16);
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+
+    constexpr std::chars_format FloatFormat(char conv)
+    {
+        return conv == 'f' ? std::chars_format::fixed
+            : conv == 'e' ? std::chars_format::scientific : std::chars_format::general;
+    }
+
+    template <typename T>
+    void AppendString(std::string& out, const T& value)
+    {
+        if constexpr (std::is_same<std::decay_t<T>, std::string>::value
+            || std::is_same<std::decay_t<T>, std::string_view>::value)
+            out.append(value.data(), value.size());
+        else
+        {
+            const char* str = value;
+            out.append(str ? str : "(null)");
+        }
+    }
+
+    template <typename Fmt, size_t Tok, typename... Stars, typename T>
+    void AppendConversion(std::string& out, const T& value, Stars... stars)
+    {
+        constexpr sToken token = Tokens<Fmt>()[Tok];
+        using U = std::decay_t<T>;
+
+        if constexpr (token.m_isPlain && token.m_conv == 's')
+            AppendString(out, value);
+        else if constexpr (token.m_isPlain && token.m_conv == 'c')
+            out.push_back(static_cast<char>(Promote(value)));
+        else if constexpr (token.m_isPlain && (token.m_conv == 'd' || token.m_conv == 'i'))
+            AppendInteger(out, static_cast<std::make_signed_t<decltype(Promote(value))>>(Promote(value)));
+        else if constexpr (token.m_isPlain && token.m_conv == 'u')
+            AppendInteger(out, static_cast<std::make_unsigned_t<decltype(Promote(value))>>(Promote(value)));
+        else if constexpr (token.m_isPlain && token.m_conv == 'x')
+            AppendHex(out, static_cast<std::make_unsigned_t<decltype(Promote(value))>>(Promote(value)));
+        else if constexpr (token.m_isPlain && Contains("feg", token.m_conv) && std::is_same<decltype(Promote(value)), double>::value)
+            AppendFloat(out, Promote(value), FloatFormat(token.m_conv), 6);
+        else if constexpr (std::is_same<U, std::string_view>::value)
+            AppendConversion<Fmt, Tok>(out, std::string(value), stars...);
+        else
+        {
+            using P = decltype(Promote(value));
+            if constexpr (token.m_conv == 'c')
+            {
+                static constexpr auto spec = BuildSpec<Fmt, Tok, int>();
+                AppendSnprintf(out, spec.data(), static_cast<int>(stars)..., static_cast<int>(Promote(value)));
+            }
+            else if constexpr (token.m_conv == 'p')
+            {
+                static constexpr auto spec = BuildSpec<Fmt, Tok, const void*>();
+                AppendSnprintf(out, spec.data(), static_cast<int>(stars)..., static_cast<const void*>(Promote(value)));
+            }
+            else
+            {
+                static constexpr auto spec = BuildSpec<Fmt, Tok, P>();
+                AppendSnprintf(out, spec.data(), static_cast<int>(stars)..., Promote(value));
+            }
+        }
+    }
+
+    template <typename Fmt, size_t Tok, typename Tuple>
+    void AppendToken(std::string& out, const Tuple& args)
+    {
+        constexpr sToken token = Tokens<Fmt>()[Tok];
+        if constexpr (!token.m_isArg)
+            out.append(Fmt::value() + token.m_begin, token.m_length);
+        else if constexpr (token.m_stars == 0)
+            AppendConversion<Fmt, Tok>(out, std::get<token.m_firstArg>(args));
+        else if constexpr (token.m_stars == 1)
+            AppendConversion<Fmt, Tok>(out, std::get<token.m_firstArg + 1>(args),
+                Promote(std::get<token.m_firstArg>(args)));
+        else
+            AppendConversion<Fmt, Tok>(out, std::get<token.m_firstArg + 2>(args),
+                Promote(std::get<token.m_firstArg>(args)), Promote(std::get<token.m_firstArg + 1>(args)));
+    }
+
+    template <typename Fmt, typename Tuple, size_t... Tok>
+    void AppendTokens(std::string& out, const Tuple& args, std::index_sequence<Tok...>)
+    {
+        (AppendToken<Fmt, Tok>(out, args), ...);
+    }
+}
+
+/**
+ * @brief Checks the arguments against a LOG_FORMAT format at compile time.
+ */
+template <typename Fmt, typename... Args>
+constexpr void CheckLogFormat()
+{
+    static_assert(std::is_base_of<sLogFormatString, Fmt>::value, "Logger: the format must be created with LOG_FORMAT");
+    static_assert(LogFormatDetail::IsValid<Fmt>(), "Logger: invalid or unsupported conversion in the format string");
+    static_assert(LogFormatDetail::ArgsCount<Fmt>() == sizeof...(Args),
+        "Logger: the number of arguments does not match the format string");
+    static_assert(LogFormatDetail::ArgsMatch<Fmt, Args...>(),
+        "Logger: an argument type does not match its conversion in the format string");
+}
+
+/**
+ * @brief Appends the formatted text to the string.
+ * @note The format is parsed at compile time: literal chunks are appended directly and every
+ * argument is converted by code generated for its conversion, without parsing at runtime.
+ */
+template <typename Fmt, typename... Args>
+void FormatLog(std::string& out, Fmt, const Args&... args)
+{
+    CheckLogFormat<Fmt, Args...>();
+    LogFormatDetail::AppendTokens<Fmt>(out, std::forward_as_tuple(args...),
+        std::make_index_sequence<LogFormatDetail::TokensCount<Fmt>()>{});
+}
@@ -0,0 +1,156 @@
+/**
+ * @file LogFormatCore.h
+ * @brief Locale-independent number and literal formatting into caller buffers.
+ *
+ * These are the conversions behind the logging calls, available to writeObject and
+ * typeToString implementations as well. Nothing here allocates except the std::string
+ * overloads when the string has to grow.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace LogFormatCoreDetail
+{
+    inline constexpr char DigitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    inline int CountDigits(uint64_t value)
+    {
+        int digits = 1;
+        for (;;)
+        {
+            if (value < 10)
+                return digits;
+            if (value < 100)
+                return digits + 1;
+            if (value < 1000)
+                return digits + 2;
+            if (value < 10000)
+                return digits + 3;
+            value /= 10000;
+            digits += 4;
+        }
+    }
+}
+
+/**
+ * @brief Space that WriteInteger needs at most, for a 64-bit value with its sign.
+ */
+constexpr size_t MaxIntegerChars = 20;
+
+/**
+ * @brief Space that WriteShortest needs at most.
+ */
+constexpr size_t MaxShortestChars = 32;
+
+/**
+ * @brief Writes the decimal digits of the value, two at a time from a table of digit pairs.
+ * @return The end of the written text, there is no terminating zero.
+ */
+inline char* WriteDecimal(char* out, uint64_t value)
+{
+    char* const end = out + LogFormatCoreDetail::CountDigits(value);
+    char* pos = end;
+    while (value >= 100)
+    {
+        pos -= 2;
+        std::memcpy(pos, LogFormatCoreDetail::DigitPairs + (value % 100) * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10)
+        std::memcpy(pos - 2, LogFormatCoreDetail::DigitPairs + value * 2, 2);
+    else
+        *--pos = static_cast<char>('0' + value);
+    return end;
+}
+
+/**
+ * @brief Writes an integer of any type in decimal, with a '-' for negative values.
+ * @return The end of the written text, at most MaxIntegerChars after out.
+ */
+template <typename T>
+inline char* WriteInteger(char* out, T value)
+{
+    static_assert(std::is_integral<T>::value, "WriteInteger needs an integer type");
+    if constexpr (std::is_signed<T>::value)
+    {
+        auto magnitude = static_cast<uint64_t>(value);
+        if (value < 0)
+        {
+            *out++ = '-';
+            magnitude = 0 - magnitude;
+        }
+        return WriteDecimal(out, magnitude);
+    }
+    else
+        return WriteDecimal(out, static_cast<uint64_t>(value));
+}
+
+/**
+ * @brief Writes the shortest text that reads back as the same double, e.g. 0.1 or 1e+300.
+ * @return The end of the written text, at most MaxShortestChars after out.
+ */
+inline char* WriteShortest(char* out, double value)
+{
+    return std::to_chars(out, out + MaxShortestChars, value).ptr;
+}
+
+template <typename T>
+inline void AppendInteger(std::string& out, T value)
+{
+    char text[MaxIntegerChars];
+    out.append(text, static_cast<size_t>(WriteInteger(text, value) - text));
+}
+
+inline void AppendShortest(std::string& out, double value)
+{
+    char text[MaxShortestChars];
+    out.append(text, static_cast<size_t>(WriteShortest(text, value) - text));
+}
+
+/**
+ * @brief Appends the value like printf does for %f, %e or %g with the given precision.
+ * @param format std::chars_format::fixed, scientific or general.
+ */
+inline void AppendFloat(std::string& out, double value, std::chars_format format, int precision)
+{
+    // Fixed notation of large values needs up to 309 digits before the point.
+    const size_t oldSize = out.size();
+    size_t room = 32 + static_cast<size_t>(precision);
+    for (;;)
+    {
+        out.resize(oldSize + room);
+        const std::to_chars_result result = std::to_chars(&out[oldSize], &out[oldSize] + room, value, format, precision);
+        if (result.ec == std::errc())
+        {
+            out.resize(static_cast<size_t>(result.ptr - out.data()));
+            return;
+        }
+        room += 320;
+    }
+}
+
+/**
+ * @brief Appends a string literal, its size is known at compile time.
+ */
+template <size_t N>
+inline void AppendLiteral(std::string& out, const char (&literal)[N])
+{
+    out.append(literal, N - 1);
+}
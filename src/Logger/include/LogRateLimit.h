@@ -0,0 +1,58 @@
+/**
+ * @file LogRateLimit.h
+ * @brief Per-call-site rate limiting and sampling used by the LOG_RATE_LIMITED and LOG_SAMPLED macros.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Token bucket of a call site: passes at most perSecond messages a second on average
+ * and bursts of up to burst messages.
+ * @note Lock-free: the bucket is kept as the time it is full again (the GCRA form of a token
+ * bucket), so a call is one clock read and one compare-and-swap.
+ */
+struct sLogRateLimiter
+{
+    sLogRateLimiter(double perSecond, unsigned burst);
+
+    sLogRateLimiter(const sLogRateLimiter&) = delete;
+    sLogRateLimiter& operator=(const sLogRateLimiter&) = delete;
+
+    /**
+     * @brief Takes a token.
+     * @param suppressed Set to the number of messages rejected since the last one passed.
+     * @return true if the message passes.
+     */
+    bool tryPass(uint64_t& suppressed);
+
+private:
+    const int64_t m_intervalNs;   //!< Time one token takes to refill
+    const int64_t m_toleranceNs;  //!< How far the refill time may run ahead of now
+    std::atomic<int64_t> m_fullAtNs{ 0 };
+    std::atomic<uint64_t> m_suppressed{ 0 };
+};
+
+/**
+ * @brief 1-in-N sampling of a call site: the first message and every N-th after it pass.
+ */
+struct sLogSampler
+{
+    explicit sLogSampler(uint64_t everyN);
+
+    sLogSampler(const sLogSampler&) = delete;
+    sLogSampler& operator=(const sLogSampler&) = delete;
+
+    /**
+     * @brief Counts the message.
+     * @param suppressed Set to the number of messages rejected since the last one passed.
+     * @return true if the message passes.
+     */
+    bool tryPass(uint64_t& suppressed);
+
+private:
+    const uint64_t m_everyN;
+    std::atomic<uint64_t> m_calls{ 0 };
+};
@@ -0,0 +1,114 @@
+/**
+ * @file LogWriter.h
+ * @brief Streams objects into the text of a log record.
+ */
+
+#pragma once
+
+#include "LogFormatCore.h"
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+struct sLogWriter;
+
+namespace LogWriterDetail
+{
+    template <typename T>
+    struct AlwaysFalse : std::false_type
+    {
+    };
+
+    template <typename T, typename = void>
+    struct HasWriteObject : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct HasWriteObject<T, std::void_t<decltype(writeObject(std::declval<sLogWriter&>(), std::declval<const T&>()))>>
+        : std::true_type
+    {
+    };
+
+    template <typename T, typename = void>
+    struct HasTypeToString : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct HasTypeToString<T, std::void_t<decltype(std::string(typeToString(std::declval<const T&>())))>>
+        : std::true_type
+    {
+    };
+}
+
+/**
+ * @brief Appends values to a buffer owned by the logger.
+ * @note A type is printable when there is a writeObject(sLogWriter&, const T&) function that
+ * argument-dependent lookup finds, e.g. in the namespace of the type:
+ *     void writeObject(sLogWriter& out, const B& obj) { out << "type B { a = " << obj.a << " }"; }
+ * Nested objects stream into the same buffer, so an object is written without temporary strings.
+ * Types without one fall back to a std::string typeToString(const T&). Enums without either
+ * are written as their underlying integer.
+ */
+struct sLogWriter
+{
+    explicit sLogWriter(std::string& out)
+        : m_out(out)
+    {
+    }
+
+    sLogWriter& append(const char* text, size_t size)
+    {
+        m_out.append(text, size);
+        return *this;
+    }
+
+    template <typename T>
+    sLogWriter& operator<<(const T& value)
+    {
+        // The functions of the user come first, an enum may have one for its names.
+        if constexpr (LogWriterDetail::HasWriteObject<T>::value)
+            writeObject(*this, value);
+        else if constexpr (LogWriterDetail::HasTypeToString<T>::value)
+            m_out.append(typeToString(value));
+        else if constexpr (std::is_same<T, bool>::value)
+            m_out.append(value ? "true" : "false");
+        else if constexpr (std::is_same<T, char>::value)
+            m_out.push_back(value);
+        else if constexpr (std::is_integral<T>::value)
+            AppendInteger(m_out, value);
+        else if constexpr (std::is_same<T, double>::value)
+            AppendShortest(m_out, value);
+        else if constexpr (std::is_floating_point<T>::value)
+            appendNumber(value);
+        else if constexpr (std::is_enum<T>::value)
+            AppendInteger(m_out, static_cast<std::underlying_type_t<T>>(value));
+        else if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value)
+            m_out.append(value ? value : "(null)");
+        else if constexpr (std::is_convertible<const T&, std::string_view>::value)
+        {
+            const std::string_view text(value);
+            m_out.append(text.data(), text.size());
+        }
+        else
+            static_assert(LogWriterDetail::AlwaysFalse<T>::value, "the type needs writeObject(sLogWriter&, const T&) or typeToString(const T&)");
+        return *this;
+    }
+
+private:
+    // float and long double, their shortest text differs from that of the double.
+    template <typename T>
+    void appendNumber(T value)
+    {
+        char digits[64];
+        const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_out.append(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    std::string& m_out;
+};
@@ -5,14 +5,29 @@
 
 #pragma once
 
+#include "LogArgs.h"
+#include "LogFields.h"
+#include "LogFormat.h"
+#include "LogRateLimit.h"
+#include "LogWriter.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 #include <memory>
-#include <unordered_map>
 #include <mutex>
 #include <thread>
+#include <vector>
 
-struct sTime;
 struct sOutputManager;
+struct sAsyncWriter;
+struct sLogRecord;
+struct sPeriodicTask;
+struct sFlightRecorder;
 
 /**
  * @brief Enumerations for time units of timer.
@@ -25,27 +40,146 @@ enum class eLogTimerUnits : uint8_t
     Nanoseconds      //!< Nanoseconds
 };
 
+/**
+ * @brief Clock source of the timers and record timestamps.
+ */
+enum class eLogClock : uint8_t
+{
+    Steady,  //!< std::chrono::steady_clock
+    Tsc      //!< CPU timestamp counter, calibrated against steady_clock
+};
+
 /**
  * @brief Enumerations for logger message type.
+ * @note Values from Trace to Error are severity levels in ascending order.
+ * None marks untagged messages, which are only filtered out when the logger is turned off.
  */
 enum class eLogMsgType : uint8_t
 {
     None,      //!< None
+    Trace,     //!< Trace
+    Debug,     //!< Debug
     Info,      //!< Info
     Warning,   //!< Warning
     Error      //!< Error
 };
 
+/**
+ * @brief Minimum severity compiled into the logging macros.
+ * @note Calls of the LOG_* macros below this level are removed at compile time.
+ * The value is the numeric value of eLogMsgType, e.g. 3 keeps Info and above.
+ */
+#ifndef SIMPLELOGGER_MIN_LEVEL
+#define SIMPLELOGGER_MIN_LEVEL 1
+#endif
+
 /**
  * @brief Flags for logger settings.
  */
-enum eLogSettings : uint8_t
+enum eLogSettings : uint32_t
 {
     UseCout = 1 << 0,     //!< Use standard output (cout)
     UseCerr = 1 << 1,     //!< Use standard error output (cerr)
     UseFile = 1 << 2,     //!< Use file output
     ShowThreadID = 1 << 3,//!< Show thread ID in log messages
-    OpenCloseFile = 1 << 4//!< Use file open-close strategy for each writing
+    OpenCloseFile = 1 << 4,//!< Use file open-close strategy for each writing
+    AsyncMode = 1 << 5,   //!< Queue records and write them from a background thread
+    DeferredFormat = 1 << 6,//!< Format messages on the background thread (requires AsyncMode)
+    MappedFile = 1 << 7,  //!< Write the file through a memory mapping (takes precedence over OpenCloseFile)
+    BinaryFile = 1 << 8,  //!< Write the file in the compact binary format, read it back with logdecode
+    ShowTimestamp = 1 << 9,//!< Start records with the local time "YYYY-MM-DD HH:MM:SS.uuuuuu"
+    PerThreadFiles = 1 << 10,//!< Every thread writes its own file without locking, merge them with logmerge (implies ShowTimestamp)
+    JsonLines = 1 << 11,  //!< Write every record as a JSON object on its own line (ignored with BinaryFile)
+    Logfmt = 1 << 12      //!< Write every record as a line of logfmt key=value pairs (ignored with BinaryFile)
+};
+
+/**
+ * @brief Layout of the text records, selected with eLogSettings::JsonLines and eLogSettings::Logfmt.
+ * @note The structured layouts write the prefix as fields: "ts" (with ShowTimestamp),
+ * "level", "thread" (with ShowThreadID) and "msg", followed by the fields of the record.
+ */
+enum class eLogLayout : uint8_t
+{
+    Text,   //!< "[Info][thread 1]: message"
+    Json,   //!< {"level":"info","thread":"1","msg":"message"}
+    Logfmt  //!< level=info thread=1 msg=message
+};
+
+/**
+ * @brief Statistics of a named timer collected in the timer aggregation mode.
+ * @note Percentiles come from a log-bucketed histogram and are within about 3% of the exact value.
+ */
+struct sLogTimerStats
+{
+    std::string m_label;
+    uint64_t m_count = 0;
+    uint64_t m_minNs = 0;
+    double m_meanNs = 0.0;
+    uint64_t m_p50Ns = 0;
+    uint64_t m_p99Ns = 0;
+    uint64_t m_maxNs = 0;
+};
+
+/**
+ * @brief Memory usage of the process.
+ */
+struct sLogMemoryUsage
+{
+    uint64_t m_rssBytes = 0;       //!< Resident set size
+    uint64_t m_virtualBytes = 0;   //!< Virtual memory size
+    uint64_t m_minorFaults = 0;    //!< Page faults served without I/O since the process started
+    uint64_t m_majorFaults = 0;    //!< Page faults that needed I/O since the process started
+};
+
+/**
+ * @brief Statistics of the snapshots taken by the memory sampler.
+ */
+struct sLogMemoryStats
+{
+    uint64_t m_samples = 0;
+    sLogMemoryUsage m_last;          //!< The latest snapshot
+    uint64_t m_peakRssBytes = 0;
+    uint64_t m_peakVirtualBytes = 0;
+};
+
+/**
+ * @brief Counters of the logger itself, see Logger::setTelemetry().
+ */
+struct sLogTelemetry
+{
+    std::array<uint64_t, 6> m_records{};   //!< Records per eLogMsgType, indexed by its numeric value
+    uint64_t m_coutBytes = 0;
+    uint64_t m_cerrBytes = 0;
+    uint64_t m_fileBytes = 0;             //!< Bytes written to the shared log file
+    uint64_t m_threadFileBytes = 0;       //!< Bytes written to the files of eLogSettings::PerThreadFiles
+    uint64_t m_fileWrites = 0;            //!< Writes to the shared and the per-thread files
+    uint64_t m_fileWriteNs = 0;           //!< Time spent in these writes
+    uint64_t m_fileSyncs = 0;             //!< Commits of the shared log file by the durability policy
+    uint64_t m_lockWaits = 0;             //!< Records that found the outputs locked by another thread
+    uint64_t m_lockWaitNs = 0;            //!< Time spent waiting for the lock
+    uint64_t m_dropped = 0;               //!< Records dropped by the asynchronous mode or a full shared ring
+    uint64_t m_suppressed = 0;            //!< Records suppressed by rate limiters and samplers
+};
+
+/**
+ * @brief Behaviour of the asynchronous mode when the record queue is full.
+ */
+enum class eLogBackpressure : uint8_t
+{
+    Block,      //!< Wait until the background thread frees a slot
+    DropNewest, //!< Discard the record that is being logged
+    DropOldest  //!< Discard the oldest queued record to make room
+};
+
+/**
+ * @brief When the log file is synced to the storage device.
+ */
+enum class eLogDurability : uint8_t
+{
+    None,          //!< Leave it to the operating system
+    EveryNRecords, //!< Sync after every N records
+    Interval,      //!< Sync at most every T milliseconds, batching the records in between (group commit)
+    OnError        //!< Sync right after every Error record
 };
 
 /**
@@ -61,11 +195,6 @@ class Logger
     Logger& operator=(Logger&&) = delete;
 
 private:
-    /**
-     * @brief Map to store timers for each thread.
-     */
-    static std::unordered_map<std::thread::id, std::unique_ptr<sTime>> m_upThreadsTimers;
-
     /**
      * @brief Pointer to the outputter responsible for displaying or writing logs.
      */
@@ -77,15 +206,113 @@ private:
     static bool m_useThreadID;
 
     /**
-     * @brief Flag indicating whether the logger is turned on or off.
+     * @brief Flag indicating whether records start with the wall-clock time.
+     */
+    static bool m_showTimestamp;
+
+    /**
+     * @brief Minimum severity that passes the runtime filter, or a value above Error when
+     * the logger is turned off. It is the only state read by the filter.
+     */
+    static std::atomic<uint8_t> m_threshold;
+
+    /**
+     * @brief Minimum severity set by setLogLevel, restored by turnOn.
+     */
+    static eLogMsgType m_minLevel;
+
+    /**
+     * @brief Flag indicating whether formatted messages are formatted by the background writer.
+     */
+    static bool m_deferFormatting;
+
+    /**
+     * @brief Flag indicating whether the file is written in the binary format.
      */
-    static bool m_isOn;
+    static bool m_binaryFile;
+
+    /**
+     * @brief Flag indicating whether every thread writes its own file.
+     */
+    static bool m_perThreadFiles;
+
+    /**
+     * @brief Flag indicating whether the text file has a sidecar index.
+     */
+    static bool m_indexedFile;
+
+    /**
+     * @brief Flag indicating whether the records go to a shared-memory ring.
+     */
+    static bool m_sharedRing;
+
+    /**
+     * @brief Layout of the text records.
+     */
+    static eLogLayout m_layout;
 
     /**
      * @brief Mutex for thread-safe operations.
      */
     static std::mutex m_mtx;
 
+    /**
+     * @brief Background writer, exists only while eLogSettings::AsyncMode is set.
+     */
+    static std::unique_ptr<sAsyncWriter> m_upAsyncWriter;
+
+    /**
+     * @brief Queue capacity used when the asynchronous mode is enabled.
+     */
+    static size_t m_asyncQueueCapacity;
+
+    /**
+     * @brief Backpressure policy used when the asynchronous mode is enabled.
+     */
+    static eLogBackpressure m_asyncBackpressure;
+
+    /**
+     * @brief Number of records dropped by previous asynchronous writers.
+     */
+    static unsigned long long m_droppedRecords;
+
+    /**
+     * @brief Ring of the last records, exists only while the flight recorder is on.
+     * @note Used by the logging threads without a lock, so it is replaced atomically and the
+     * previous recorder is deleted once m_flightRecorderUsers shows nobody holds it any more.
+     */
+    static std::atomic<sFlightRecorder*> m_flightRecorder;
+
+    /**
+     * @brief Number of threads using the flight recorder right now.
+     */
+    static std::atomic<unsigned> m_flightRecorderUsers;
+
+    /**
+     * @brief Background thread for periodic work such as interval commits.
+     */
+    static std::unique_ptr<sPeriodicTask> m_upHousekeeper;
+
+    /**
+     * @brief Flag indicating whether stopped timers feed histograms instead of printing.
+     */
+    static std::atomic<bool> m_aggregateTimers;
+
+    /**
+     * @brief Background thread printing the timer statistics at a fixed interval.
+     */
+    static std::unique_ptr<sPeriodicTask> m_upTimerReporter;
+
+    /**
+     * @brief Background thread taking the memory snapshots at a fixed interval.
+     */
+    static std::unique_ptr<sPeriodicTask> m_upMemorySampler;
+
+    /**
+     * @brief Background thread printing the telemetry summary at a fixed interval.
+     */
+    static std::unique_ptr<sPeriodicTask> m_upTelemetryReporter;
+
 public:
     /**
      * @brief Turns off the logger.
@@ -99,6 +326,44 @@ public:
      */
     static void turnOn();
 
+    /**
+     * @brief Sets the minimum severity of logged messages.
+     * @param minLevel Messages below this level are skipped. eLogMsgType::None or Trace let everything through.
+     * @note Untagged (eLogMsgType::None) messages and timers are not affected.
+     */
+    static void setLogLevel(eLogMsgType minLevel);
+
+    /**
+     * @brief Returns the minimum severity of logged messages.
+     */
+    static eLogMsgType getLogLevel();
+
+    /**
+     * @brief Returns the severity used for filtering. Untagged messages rank as Error.
+     */
+    static constexpr uint8_t severity(eLogMsgType type)
+    {
+        return static_cast<uint8_t>(type == eLogMsgType::None ? eLogMsgType::Error : type);
+    }
+
+    /**
+     * @brief Checks whether messages of the type are compiled into the LOG_* macros.
+     */
+    static constexpr bool isCompiledIn(eLogMsgType type)
+    {
+        // Compared as int, so a level of 0 does not make the comparison always true.
+        return static_cast<int>(severity(type)) >= SIMPLELOGGER_MIN_LEVEL;
+    }
+
+    /**
+     * @brief Checks whether messages of the type pass the runtime filter.
+     * @note This is a single relaxed atomic load.
+     */
+    static bool isEnabled(eLogMsgType type)
+    {
+        return severity(type) >= m_threshold.load(std::memory_order_relaxed);
+    }
+
     /**
      * @brief Adjusts the logger settings based on the provided flags.
      * @param settingsFlags The flags specifying the settings to adjust.
@@ -111,9 +376,130 @@ public:
      * @param file The file path for logging.
      * @param addProcessID Adds the process ID to the file name. It helps to generate different logs for different runs.
      * @note This method have no affect if the eLogSettings::UseFile is not setted
+     * @note The file is written with the strategy selected by adjustSettings: a buffered stream,
+     * eLogSettings::OpenCloseFile or eLogSettings::MappedFile. A mapped file is extended in 4 MB
+     * chunks and truncated to its real length when it is closed.
+     * @note With eLogSettings::PerThreadFiles every thread writes "<index>_<file name>" next to
+     * the path, e.g. "1234_3_log.txt" with the process ID. Rotation and durability apply to
+     * the shared file only.
      */
     static void setLogFilePath(const std::string& file, bool addProcessID = true);
 
+    /**
+     * @brief Sets when the log file is synced (fsync) to the storage device.
+     * @param policy The durability policy.
+     * @param value N for eLogDurability::EveryNRecords, T in milliseconds for eLogDurability::Interval.
+     * @note Records between two commits are batched, so the cost of a sync is shared by all of them.
+     */
+    static void setDurability(eLogDurability policy, unsigned value = 0);
+
+    /**
+     * @brief Keeps the last records in a preallocated in-memory ring, next to the outputs
+     * or instead of them.
+     * @param capacity Size of the ring in bytes, 0 turns the recorder off.
+     * @param dumpPath File the ring is appended to when it is dumped.
+     * @param dumpOnError Whether every Error record dumps the ring.
+     * @param handleSignals Whether SIGSEGV and SIGABRT dump the ring before the process ends.
+     * The handlers are async-signal-safe and pass the signal on to the previous handlers.
+     * @note A dump writes only the records added since the previous dump. Recording costs a
+     * copy of the record text and takes no lock. The recorder may be replaced while other
+     * threads log, the call waits until none of them uses the previous one.
+     */
+    static void setFlightRecorder(size_t capacity, const std::string& dumpPath, bool dumpOnError = true,
+        bool handleSignals = true);
+
+    /**
+     * @brief Dumps the flight recorder on request, does nothing if it is off.
+     */
+    static void dumpFlightRecorder();
+
+    /**
+     * @brief Rotates the log file by size and/or age.
+     * @param maxFileSize The file is rotated once it reaches this many bytes, 0 disables the limit.
+     * @param interval The file is rotated when it is older than this, 0 disables the limit.
+     * @param maxFiles Number of rotated files kept, the oldest are removed. 0 keeps all of them.
+     * @param compress Whether rotated files are compressed into LZ4 frames (".lz4").
+     * @note A rotated file is renamed to "<log file>.<YYYYMMDD-HHMMSS>-<NNNNNN>", numbered within
+     * the second. Only files named like that count as rotated files. Compression and removal
+     * run on a low-priority background thread, so rotation only costs a rename and an open.
+     * setRotation(0) turns rotation off.
+     */
+    static void setRotation(uint64_t maxFileSize, std::chrono::seconds interval = std::chrono::seconds(0),
+        unsigned maxFiles = 0, bool compress = true);
+
+    /**
+     * @brief Writes a sparse index next to the text log file, "<log file>.idx", for logsearch.
+     * @param blockKiB Size of the indexed blocks in KiB, 0 turns the index off.
+     * @note Every block entry holds the offset and length of the block, the time range of its
+     * records and a bitmap of their levels and threads. The time range needs ShowTimestamp.
+     * A rotated file keeps its index as "<segment>.idx". Binary and per-thread files are not indexed.
+     */
+    static void setLogIndex(unsigned blockKiB);
+
+    /**
+     * @brief Sends the records of the process to a shared-memory ring, which the logcollect tool
+     * drains together with the rings of the other processes into one log ordered by time.
+     * @param directory Directory of the ring files, preferably on a memory file system such as
+     * "/dev/shm/app". An empty path turns the ring off.
+     * @param capacity Size of the ring in bytes, rounded up to a power of two.
+     * @note The ring is an output next to the ones selected by adjustSettings. Publishing a
+     * record is a copy and an atomic store, without a system call. Records that do not fit
+     * while the collector is behind are dropped and counted. The records a crashed process
+     * has published stay in its ring file until the collector drains them.
+     * The ring is available on POSIX systems only.
+     */
+    static void setSharedRing(const std::string& directory, size_t capacity = 4 * 1024 * 1024);
+
+    /**
+     * @brief Configures the record queue of the asynchronous mode.
+     * @param queueCapacity The maximum number of queued records, rounded up to a power of two.
+     * @param policy What to do when the queue is full.
+     * @note Takes effect immediately if eLogSettings::AsyncMode is already set.
+     */
+    static void setAsyncOptions(size_t queueCapacity, eLogBackpressure policy = eLogBackpressure::Block);
+
+    /**
+     * @brief Waits until every record logged before the call is written and flushes the outputs.
+     */
+    static void flush();
+
+    /**
+     * @brief Returns the number of records dropped by the asynchronous mode because the queue was full.
+     */
+    static unsigned long long droppedRecords();
+
+    /**
+     * @brief Prints a message with typed key/value fields.
+     * @param type The type of the log message.
+     * @param msg The message to be logged.
+     * @param fields The fields, e.g. {{"status", 200}, {"path", path}, {"ms", 3.5}}.
+     * @note The fields are encoded straight into the record: as JSON members or logfmt pairs
+     * in the structured layouts, as " key=value" after the message in the text layout.
+     */
+    static void printFields(eLogMsgType type, std::string_view msg, std::initializer_list<sLogField> fields);
+
+    /**
+     * @brief Prints "suppressed N similar messages" with the given type.
+     * @note Called by the rate limiting and sampling macros before the next message of a
+     * call site that passes, so the count covers the messages rejected in between.
+     */
+    static void reportSuppressed(eLogMsgType type, uint64_t count);
+
+    /**
+     * @brief Names the current thread, e.g. "io-0" or "worker-3".
+     * @note The name replaces the thread ID in the thread tag and in the binary format.
+     * Name a thread before it logs: a binary file keeps the name a thread had when it
+     * first logged into that file.
+     */
+    static void setThreadName(std::string_view name);
+
+    /**
+     * @brief Returns the index of the current thread.
+     * @note Indexes are small and dense: threads are numbered from 0 in the order they first log,
+     * are named or ask for their index.
+     */
+    static uint32_t threadIndex();
+
     /**
      * @brief Prints a log message with optional message type.
      * @param msg The message to be logged.
@@ -122,52 +508,237 @@ public:
     static void print(const std::string& msg, eLogMsgType type = eLogMsgType::None);
 
     /**
-     * @brief Starts a timer with the specified message.
-     * @param msg The message associated with the timer.
+     * @brief Starts a timer on the timer stack of the current thread.
+     * @param name The name of the timer, printed when it stops.
+     * @note Timers nest: every thread has its own stack, so starting and stopping a timer
+     * takes no lock. Nothing is printed until the timer stops.
+     */
+    static void startTimer(std::string_view name);
+
+    /**
+     * @brief Stops the innermost timer of the current thread and prints the elapsed time.
+     * @param units The units in which to display the elapsed time.
+     * @param msg The message printed after the name of the timer.
+     * @note The message is indented by the number of timers still running on the thread.
      */
-    static void startTimer(const std::string& msg);
+    static void stopTimer(eLogTimerUnits units, std::string_view msg);
 
     /**
-     * @brief Stops a timer and prints the elapsed time.
+     * @brief Stops the innermost timer with the given name and prints the elapsed time.
+     * @param name The name passed to startTimer.
      * @param units The units in which to display the elapsed time.
-     * @param msg The message associated with the timer.
+     * @param msg The message printed after the name of the timer.
+     * @note Nothing happens if no timer of the thread has this name.
+     */
+    static void stopTimer(std::string_view name, eLogTimerUnits units, std::string_view msg = {});
+
+    /**
+     * @brief Selects the clock source of the timers and record timestamps.
+     * @return The clock in use. Tsc falls back to Steady when the CPU has no invariant timestamp counter.
+     * @note Selecting Tsc calibrates the counter for about 10 ms. Timers running while the
+     * clock changes report meaningless durations.
+     */
+    static eLogClock setClock(eLogClock clock);
+
+    /**
+     * @brief Switches the timer aggregation mode.
+     * @param isEnabled In this mode a stopped timer prints nothing, its duration is added to
+     * a per-thread histogram of its name instead.
+     * @param reportInterval If not zero, the statistics are printed and reset at this interval.
+     */
+    static void setTimerAggregation(bool isEnabled, std::chrono::milliseconds reportInterval = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Merges the timer histograms of all threads into statistics per name.
+     * @param reset Whether the histograms start over.
+     */
+    static std::vector<sLogTimerStats> timerStats(bool reset = false);
+
+    /**
+     * @brief Prints one "[timer stats]" line per timer name with the count, min, mean, p50, p99 and max.
+     * @param reset Whether the histograms start over.
+     */
+    static void reportTimerStats(bool reset = true);
+
+    /**
+     * @brief Reads the memory usage of the process.
+     * @return false if the platform offers no such figures (only Linux does).
+     * @note The figures are read from procfs with a file descriptor that stays open, a call takes about a microsecond.
+     */
+    static bool memoryUsage(sLogMemoryUsage& usage);
+
+    /**
+     * @brief Starts a memory region on the region stack of the current thread.
+     * @param name The name of the region, printed when it stops.
+     * @note Regions nest like timers. The sizes are those of the whole process, so memory
+     * allocated by other threads meanwhile counts as well. The page faults are those of the
+     * current thread.
+     */
+    static void startMemoryRegion(std::string_view name);
+
+    /**
+     * @brief Stops the innermost memory region of the current thread and prints the resident
+     * and virtual size with their growth and the page faults since the region started.
+     * @param msg The message printed after the name of the region.
+     */
+    static void stopMemoryRegion(std::string_view msg = {});
+
+    /**
+     * @brief Starts or stops the memory sampler.
+     * @param interval Period of the snapshots, zero stops the sampler.
+     * @param printSamples Whether every snapshot is printed, otherwise they only feed memoryStats().
+     * @note The snapshots are taken on the sampler thread, the logging threads are not involved.
      */
-    static void stopTimer(eLogTimerUnits units, const std::string& msg);
+    static void setMemorySampler(std::chrono::milliseconds interval, bool printSamples = true);
+
+    /**
+     * @brief Returns the statistics of the memory sampler.
+     * @param reset Whether the statistics start over.
+     */
+    static sLogMemoryStats memoryStats(bool reset = false);
+
+    /**
+     * @brief Turns the counters of the logger itself on or off.
+     * @param isEnabled While on, records per type, bytes per output, lock waits, file write
+     * times, drops and suppressions are counted. Every thread counts into its own shard.
+     * @param summaryInterval If not zero, a summary is printed and the counters reset at this interval.
+     */
+    static void setTelemetry(bool isEnabled, std::chrono::milliseconds summaryInterval = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Returns the counters summed over all threads.
+     * @param reset Whether the counters start over.
+     */
+    static sLogTelemetry telemetry(bool reset = false);
+
+    /**
+     * @brief Prints a "[telemetry]" line with the counters.
+     * @param reset Whether the counters start over.
+     */
+    static void reportTelemetry(bool reset = true);
 
 private:
     /**
-     * @brief Starts a timer for the current thread.
+     * @brief Prints the record of a memory region or a snapshot of the sampler.
+     * @param before The usage the growth and the page faults are counted from.
      */
-    static void startTimerForCurrThread();
+    static void printMemory(std::string_view name, std::string_view msg,
+        const sLogMemoryUsage& now, const sLogMemoryUsage& before);
 
     /**
-     * @brief Stops the timer for the current thread and returns the elapsed time.
-     * @param units The units in which to return the elapsed time.
+     * @brief Prints the record of a stopped timer.
+     * @param elapsed The elapsed time in units.
+     * @param depth The number of timers still running on the thread.
      */
-    static long long stopTimerForCurrThread(eLogTimerUnits units);
+    static void printTimer(long long elapsed, eLogTimerUnits units, size_t depth,
+        std::string_view name, std::string_view msg);
 
     /**
-     * @brief Prints the current thread ID.
+     * @brief Returns the cleared record of the current thread, starting with the timestamp if it is shown.
      */
-    static void printThreadID();
+    static sLogRecord& newRecord();
 
     /**
-     * @brief Prints a string representation of an object.
-     * @param objStr The string representation of the object.
+     * @brief Appends the message type tag, the thread ID and the separator to the record.
+     * @param record The record being assembled.
+     * @param type The type of the log message.
+     */
+    static void appendPrefix(sLogRecord& record, eLogMsgType type);
+
+    /**
+     * @brief Appends the cached tag with the name or ID of the current thread to the record.
+     * @param record The record being assembled.
+     */
+    static void appendThreadID(sLogRecord& record);
+
+    /**
+     * @brief Appends the message, escaped and quoted as the layout requires.
      */
-    static void printObjectStr(const std::string& objStr);
+    static void appendMessage(sLogRecord& record, std::string_view msg);
+
+    /**
+     * @brief Appends a key/value field after the message.
+     */
+    static void appendField(sLogRecord& record, const sLogField& field);
+
+    /**
+     * @brief Closes the record and appends the line break.
+     */
+    static void endRecord(sLogRecord& record);
+
+    /**
+     * @brief Writes the record directly or hands it over to the background writer.
+     * @param record The finished record. Its content is unspecified after the call.
+     */
+    static void dispatch(sLogRecord& record);
+
+    /**
+     * @brief Periodic work run by the housekeeper thread.
+     */
+    static void housekeeping();
+
+    /**
+     * @brief Starts the housekeeper thread if the current settings need periodic work.
+     */
+    static void startHousekeeper();
+
+    /**
+     * @brief Creates or destroys the background writer according to the current settings.
+     * @param isAsync Whether the asynchronous mode should be running.
+     */
+    static void resetAsyncWriter(bool isAsync);
+
+    /**
+     * @brief Prints the text written for an object.
+     * @param type The type of the log message.
+     * @param text The text of the object.
+     */
+    static void printObjectText(eLogMsgType type, std::string_view text);
+
+    /**
+     * @brief Returns the buffer used by the current thread to write objects.
+     */
+    static std::string& objectBufferForCurrThread();
+
+    /**
+     * @brief Returns the buffer used by the current thread to capture formatting arguments.
+     */
+    static std::string& argsBufferForCurrThread();
+
+    /**
+     * @brief Returns the buffer used by the current thread to format messages.
+     */
+    static std::string& textBufferForCurrThread();
+
+    /**
+     * @brief Prints a message from a format string and arguments captured by EncodeLogArgs.
+     * @param type The type of the log message.
+     * @param format The format string.
+     * @param args The captured arguments.
+     * @param isStaticFormat Whether the format outlives the logger, like the ones of LOG_FORMAT.
+     * Other formats are copied into the records that are written later by the background thread.
+     */
+    static void printArgs(eLogMsgType type, const char* format, const std::string& args, bool isStaticFormat);
 
 public:
     /**
      * @brief Prints a string representation of an object.
      * @tparam T The type of the object.
      * @param obj The object to be printed.
-     * @note This method assumes that there exists a typeToString friend function that can convert the object to a string.
+     * @param type The type of the log message. Objects printed without one have no prefix in the text layout.
+     * @note The object is written by a writeObject(sLogWriter&, const T&) function into a buffer
+     * of the calling thread, see sLogWriter. Types without one need a typeToString(const T&) function.
      */
     template<typename T>
-    static void printObject(const T& obj)
+    static void printObject(const T& obj, eLogMsgType type = eLogMsgType::None)
     {
-        printObjectStr(typeToString(obj));
+        if (!isEnabled(type))
+            return;
+        std::string& text = objectBufferForCurrThread();
+        text.clear();
+        sLogWriter writer(text);
+        writer << obj;
+        printObjectText(type, text);
     }
 
     /**
@@ -176,12 +747,200 @@ public:
      * @param type The type of the log message.
      * @param format The format string for printing.
      * @param args Variadic arguments to be formatted and printed.
+     * @note The arguments are captured in a compact binary form (strings are copied) and
+     * the message has no length limit. With eLogSettings::DeferredFormat the formatting
+     * itself happens on the background thread, from a copy of the format string.
      */
     template <typename... Args>
-    static void print(eLogMsgType type, const char* format, Args... args)
+    static void print(eLogMsgType type, const char* format, const Args&... args)
     {
-        char buff[1024];
-        std::snprintf(buff, 1024, format, args...);
-        print(buff, type);
+        if (!isEnabled(type))
+            return;
+        std::string& buffer = argsBufferForCurrThread();
+        buffer.clear();
+        EncodeLogArgs(buffer, args...);
+        printArgs(type, format, buffer, false);
     }
-};
\ No newline at end of file
+
+    /**
+     * @brief Prints a formatted log message checked at compile time.
+     * @tparam Fmt The format type created by LOG_FORMAT.
+     * @tparam Args Variadic template parameter pack for formatting arguments.
+     * @param type The type of the log message.
+     * @param format The format created by LOG_FORMAT("...").
+     * @param args Variadic arguments to be formatted and printed.
+     * @note A wrong number of arguments or an argument that does not fit its conversion
+     * is a compile error. The formatting code is generated for the call site, so the format
+     * is not parsed at runtime.
+     */
+    template <typename Fmt, typename... Args>
+    static std::enable_if_t<std::is_base_of<sLogFormatString, Fmt>::value>
+        print(eLogMsgType type, Fmt format, const Args&... args)
+    {
+        CheckLogFormat<Fmt, Args...>();
+        if (!isEnabled(type))
+            return;
+        if (m_deferFormatting || m_binaryFile)
+        {
+            std::string& buffer = argsBufferForCurrThread();
+            buffer.clear();
+            EncodeLogArgs(buffer, args...);
+            printArgs(type, Fmt::value(), buffer, true);
+            return;
+        }
+
+        std::string& text = textBufferForCurrThread();
+        text.clear();
+        FormatLog(text, format, args...);
+        print(text, type);
+    }
+};
+
+/**
+ * @brief Logs a message if its type passes both the compile-time and the runtime filter.
+ * @note The message expression is not evaluated when the message is filtered out.
+ */
+#define LOG_MESSAGE(type, msg) \
+    do \
+    { \
+        if constexpr (Logger::isCompiledIn(type)) \
+        { \
+            if (Logger::isEnabled(type)) \
+                Logger::print(msg, type); \
+        } \
+    } while (false)
+
+/**
+ * @brief Logs a compile-time checked formatted message if its type passes both filters.
+ * @note The arguments are not evaluated when the message is filtered out.
+ */
+#define LOG_FORMATTED(type, format, ...) \
+    do \
+    { \
+        if constexpr (Logger::isCompiledIn(type)) \
+        { \
+            if (Logger::isEnabled(type)) \
+                Logger::print(type, LOG_FORMAT(format), ##__VA_ARGS__); \
+        } \
+    } while (false)
+
+#define LOG_TRACE(msg) LOG_MESSAGE(eLogMsgType::Trace, msg)
+#define LOG_DEBUG(msg) LOG_MESSAGE(eLogMsgType::Debug, msg)
+#define LOG_INFO(msg) LOG_MESSAGE(eLogMsgType::Info, msg)
+#define LOG_WARNING(msg) LOG_MESSAGE(eLogMsgType::Warning, msg)
+#define LOG_ERROR(msg) LOG_MESSAGE(eLogMsgType::Error, msg)
+
+#define LOG_TRACEF(format, ...) LOG_FORMATTED(eLogMsgType::Trace, format, ##__VA_ARGS__)
+#define LOG_DEBUGF(format, ...) LOG_FORMATTED(eLogMsgType::Debug, format, ##__VA_ARGS__)
+#define LOG_INFOF(format, ...) LOG_FORMATTED(eLogMsgType::Info, format, ##__VA_ARGS__)
+#define LOG_WARNINGF(format, ...) LOG_FORMATTED(eLogMsgType::Warning, format, ##__VA_ARGS__)
+#define LOG_ERRORF(format, ...) LOG_FORMATTED(eLogMsgType::Error, format, ##__VA_ARGS__)
+
+/**
+ * @brief Runs the statement if the limiter of the call site lets the message pass, after
+ * reporting the messages the limiter rejected since the last one passed.
+ * @param limiterArgs The parenthesized constructor arguments of the limiter.
+ * @note The limiter is a static object of the call site. Filtered out messages do not count.
+ */
+#define LOG_LIMITED(type, limiterType, limiterArgs, statement) \
+    do \
+    { \
+        if constexpr (Logger::isCompiledIn(type)) \
+        { \
+            static limiterType logLimiter limiterArgs; \
+            uint64_t logSuppressed = 0; \
+            if (Logger::isEnabled(type) && logLimiter.tryPass(logSuppressed)) \
+            { \
+                if (logSuppressed > 0) \
+                    Logger::reportSuppressed(type, logSuppressed); \
+                statement; \
+            } \
+        } \
+    } while (false)
+
+/**
+ * @brief Logs at most perSecond messages a second from this call site, with bursts of up to burst.
+ */
+#define LOG_RATE_LIMITED(type, perSecond, burst, msg) \
+    LOG_LIMITED(type, sLogRateLimiter, (perSecond, burst), Logger::print(msg, type))
+#define LOG_RATE_LIMITEDF(type, perSecond, burst, format, ...) \
+    LOG_LIMITED(type, sLogRateLimiter, (perSecond, burst), Logger::print(type, LOG_FORMAT(format), ##__VA_ARGS__))
+
+/**
+ * @brief Logs the first message of this call site and every N-th message after it.
+ */
+#define LOG_SAMPLED(type, everyN, msg) \
+    LOG_LIMITED(type, sLogSampler, (everyN), Logger::print(msg, type))
+#define LOG_SAMPLEDF(type, everyN, format, ...) \
+    LOG_LIMITED(type, sLogSampler, (everyN), Logger::print(type, LOG_FORMAT(format), ##__VA_ARGS__))
+
+/**
+ * @brief Times the enclosing scope with a named timer of the current thread.
+ * @note Timers nest, the output of an inner timer is indented under the outer one.
+ */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(std::string_view name, eLogTimerUnits units = eLogTimerUnits::Microseconds)
+        : m_units(units)
+    {
+        Logger::startTimer(name);
+    }
+
+    // Scopes nest, so the innermost timer of the thread is the one started above.
+    ~ScopedTimer()
+    {
+        Logger::stopTimer(m_units, {});
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    eLogTimerUnits m_units;
+};
+
+/**
+ * @brief Prints the memory growth of the enclosing scope as a memory region of the current thread.
+ */
+class ScopedMemoryRegion
+{
+public:
+    explicit ScopedMemoryRegion(std::string_view name)
+    {
+        Logger::startMemoryRegion(name);
+    }
+
+    ~ScopedMemoryRegion()
+    {
+        Logger::stopMemoryRegion();
+    }
+
+    ScopedMemoryRegion(const ScopedMemoryRegion&) = delete;
+    ScopedMemoryRegion& operator=(const ScopedMemoryRegion&) = delete;
+};
+
+#define LOG_CONCAT_IMPL(a, b) a##b
+#define LOG_CONCAT(a, b) LOG_CONCAT_IMPL(a, b)
+
+#define LOG_SCOPED_TIMER(name, units) ScopedTimer LOG_CONCAT(logScopedTimer, __LINE__)(name, units)
+
+/**
+ * @brief Starts a timer. The message is not evaluated when the logger is turned off.
+ */
+#define LOG_START_TIMER(msg) \
+    do \
+    { \
+        if (Logger::isEnabled(eLogMsgType::None)) \
+            Logger::startTimer(msg); \
+    } while (false)
+
+/**
+ * @brief Stops a timer. The message is not evaluated when the logger is turned off.
+ */
+#define LOG_STOP_TIMER(units, msg) \
+    do \
+    { \
+        if (Logger::isEnabled(eLogMsgType::None)) \
+            Logger::stopTimer(units, msg); \
+    } while (false)
@@ -17,6 +17,7 @@ int main(int argc, char* argv[])
     Logger::print("Example of error message", eLogMsgType::Error);
     Logger::print("Example of warning message", eLogMsgType::Warning);
     Logger::print("Example of info message", eLogMsgType::Info);
+    Logger::print(eLogMsgType::Info, LOG_FORMAT("Example of %s message checked at compile time: %d"), "formatted", 42);
     Logger::print("\n------------------------------------------\n");
     Logger::print("Next output describe work of Logger in multiple threads with time calculation:", eLogMsgType::Info);
 
@@ -29,9 +30,10 @@ int main(int argc, char* argv[])
     for (int i = 0; i < threadNum; ++i)
     {
         threads[i] = std::thread([](int id, int sleepTime) {
-            Logger::startTimer("Thread " + std::to_string(id));
+            LOG_START_TIMER("Thread " + std::to_string(id));
             std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
-            Logger::stopTimer(eLogTimerUnits::Milliseconds, "Thread " + std::to_string(id) + " end of execution");
+            LOG_DEBUGF("Thread %d woke up after %d ms", id, sleepTime);
+            LOG_STOP_TIMER(eLogTimerUnits::Milliseconds, "end of execution");
             },
             i + 1, sleepTimes[i]);
     }
@@ -46,5 +48,5 @@ int main(int argc, char* argv[])
     A objA;
     Logger::printObject(objA);
     B objB;
-    Logger::printObject(objB);
+    Logger::printObject(objB, eLogMsgType::Info);
 }
@@ -1,8 +1,27 @@
 #define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <chrono>
+#include <csignal>
 #include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <regex>
+#include <thread>
+#include <vector>
 #include "Logger.h"
+#include "BinaryLog.h"
+#include "Compression.h"
+#include "LogIndex.h"
+#include "SharedRing.h"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 namespace
 {
@@ -19,6 +38,128 @@ namespace
         return "type A { first = " + std::to_string(obj.first)
             + " precision = " + std::to_string(obj.precision) + "}";
     }
+
+    enum class eColor
+    {
+        Red,
+        Green
+    };
+
+    enum class eShape
+    {
+        Circle,
+        Square
+    };
+
+    std::string typeToString(const eColor& color)
+    {
+        return color == eColor::Green ? "Green" : "Red";
+    }
+
+    struct sPoint
+    {
+        int x = 1;
+        double y = 2.5;
+    };
+
+    struct sSegment
+    {
+        sPoint from;
+        sPoint to{ -3, 0.125 };
+        std::string name = "edge";
+    };
+
+    void writeObject(sLogWriter& out, const sPoint& point)
+    {
+        out << '(' << point.x << ", " << point.y << ')';
+    }
+
+    void writeObject(sLogWriter& out, const sSegment& segment)
+    {
+        out << segment.name << ' ' << segment.from << " -> " << segment.to << " nested " << A();
+    }
+
+    constexpr auto checkedFormat = LOG_FORMAT("%d %s %*.2f");
+    using CheckedFormat = std::decay_t<decltype(checkedFormat)>;
+    static_assert(LogFormatDetail::ArgsMatch<CheckedFormat, int, std::string, int, double>(), "valid arguments");
+    static_assert(!LogFormatDetail::ArgsMatch<CheckedFormat, double, std::string, int, double>(), "wrong type");
+    static_assert(!LogFormatDetail::ArgsMatch<CheckedFormat, int, std::string>(), "missing arguments");
+
+    uint32_t ReadLE32(const std::string& data, size_t pos)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i)
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(data[pos + i])) << (8 * i);
+        return value;
+    }
+
+    // Length of a literal run or match, extended by bytes of 255 while they last.
+    bool ReadLz4Length(const std::string& data, size_t& pos, size_t end, size_t& length)
+    {
+        if (length != 15)
+            return true;
+        for (uint8_t next = 255; next == 255; length += next)
+        {
+            if (pos >= end)
+                return false;
+            next = static_cast<uint8_t>(data[pos++]);
+        }
+        return true;
+    }
+
+    // Decodes an LZ4 frame as sLz4FrameWriter writes it and checks its content checksum.
+    bool DecodeLz4Frame(const std::string& frame, std::string& out)
+    {
+        if (frame.size() < 7 || ReadLE32(frame, 0) != 0x184D2204U || (frame[4] & 0x18) != 0)
+            return false;
+        const bool hasChecksum = (frame[4] & 0x04) != 0;
+        size_t pos = 7;
+        for (;;)
+        {
+            if (pos + 4 > frame.size())
+                return false;
+            const uint32_t blockSize = ReadLE32(frame, pos);
+            pos += 4;
+            if (blockSize == 0)
+                break;
+            const size_t size = blockSize & 0x7FFFFFFFU;
+            const size_t end = pos + size;
+            if (end > frame.size())
+                return false;
+            if ((blockSize & 0x80000000U) != 0)
+            {
+                out.append(frame, pos, size);
+                pos = end;
+                continue;
+            }
+            while (pos < end)
+            {
+                const auto token = static_cast<uint8_t>(frame[pos++]);
+                size_t literals = token >> 4;
+                if (!ReadLz4Length(frame, pos, end, literals) || pos + literals > end)
+                    return false;
+                out.append(frame, pos, literals);
+                pos += literals;
+                if (pos == end)
+                    break;
+                if (pos + 2 > end)
+                    return false;
+                const size_t offset = static_cast<uint8_t>(frame[pos]) | (static_cast<size_t>(static_cast<uint8_t>(frame[pos + 1])) << 8);
+                pos += 2;
+                size_t match = token & 0x0F;
+                if (offset == 0 || offset > out.size() || !ReadLz4Length(frame, pos, end, match))
+                    return false;
+                // Byte by byte, a match may overlap the bytes it copies.
+                for (size_t i = 0; i < match + 4; ++i)
+                    out.push_back(out[out.size() - offset]);
+            }
+        }
+        if (!hasChecksum)
+            return pos == frame.size();
+        sXxHash32 hash;
+        hash.update(out.data(), out.size());
+        return pos + 4 == frame.size() && ReadLE32(frame, pos) == hash.digest();
+    }
 }
 
 class LoggerTestFixture : public ::testing::Test
@@ -91,6 +232,22 @@ TEST_F(LoggerTestFixture, ShowThreadIDTest)
     EXPECT_NE(text.find("[thread"), std::string::npos);
 }
 
+TEST_F(LoggerTestFixture, NamedThreadTag)
+{
+    Logger::adjustSettings(defaultFlags | eLogSettings::ShowThreadID);
+    uint32_t workerIndex = 0;
+    std::thread([&workerIndex]() {
+        Logger::setThreadName("worker-3");
+        workerIndex = Logger::threadIndex();
+        Logger::print("Named thread message");
+    }).join();
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    EXPECT_EQ(text, "[thread worker-3]: Named thread message");
+    EXPECT_NE(workerIndex, Logger::threadIndex());
+}
+
 TEST_F(LoggerTestFixture, ShowInfoTag)
 {
     Logger::print("Test log message", eLogMsgType::Info);
@@ -122,15 +279,16 @@ TEST_F(LoggerTestFixture, ShowTimeStamp)
 {
     Logger::startTimer("Timer start");
 
-    //dummy cycle, not sure if it will be present in optimized code :)
-    for (size_t i = 0; i < LONG_MAX; ++i);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
 
     Logger::stopTimer(eLogTimerUnits::Milliseconds, "Timer stop");
 
     std::string text;
     EXPECT_TRUE(GetLogFileText(text));
-    EXPECT_NE(text.find("[timer start]"), std::string::npos);
+    // Timers print only when they stop.
+    EXPECT_EQ(text.find("[timer start]"), std::string::npos);
     EXPECT_NE(text.find("[timer stop"), std::string::npos);
+    EXPECT_NE(text.find("millisec]: Timer start: Timer stop"), std::string::npos);
 }
 
 TEST_F(LoggerTestFixture, PrintFormattedString)
@@ -152,3 +310,1032 @@ TEST_F(LoggerTestFixture, PrintCustomType)
     EXPECT_EQ(text, "type A { first = 34 precision = 0.003000}");
 }
 
+TEST_F(LoggerTestFixture, PrintStreamedObject)
+{
+    const sSegment segment;
+    Logger::printObject(segment, eLogMsgType::Warning);
+    Logger::setLogLevel(eLogMsgType::Debug);
+    Logger::printObject(segment, eLogMsgType::Trace);
+    Logger::setLogLevel(eLogMsgType::Trace);
+    Logger::adjustSettings(defaultFlags | eLogSettings::JsonLines);
+    Logger::printObject(sPoint(), eLogMsgType::Error);
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(logFilePath);
+    std::string line;
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, "[Warning]: edge (1, 2.5) -> (-3, 0.125) nested type A { first = 34 precision = 0.003000}");
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, R"json({"level":"error","msg":"(1, 2.5)"})json");
+    EXPECT_FALSE(std::getline(file, line));
+}
+
+TEST_F(LoggerTestFixture, PrintEnumObject)
+{
+    Logger::printObject(eColor::Green, eLogMsgType::Info);
+    Logger::printObject(eShape::Square, eLogMsgType::Info);
+
+    std::ifstream file(logFilePath);
+    std::string line;
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, "[Info]: Green");
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, "[Info]: 1");
+}
+
+#ifdef __linux__
+TEST_F(LoggerTestFixture, MemoryRegionCountsThreadFaults)
+{
+    Logger::startMemoryRegion("idle");
+    // Another thread touches 64 MiB of new pages meanwhile.
+    std::thread([]()
+    {
+        std::vector<char> buffer(64 << 20, 1);
+        EXPECT_EQ(buffer.back(), 1);
+    }).join();
+    Logger::stopMemoryRegion();
+
+    std::ifstream file(logFilePath);
+    std::string line;
+    ASSERT_TRUE(std::getline(file, line));
+    const size_t pos = line.find("minflt=");
+    ASSERT_NE(pos, std::string::npos) << line;
+    EXPECT_LT(std::stoull(line.substr(pos + 7)), 4096u) << line;
+}
+
+TEST_F(LoggerTestFixture, MemoryRegionAndSampler)
+{
+    sLogMemoryUsage usage;
+    ASSERT_TRUE(Logger::memoryUsage(usage));
+    EXPECT_GT(usage.m_rssBytes, 0u);
+    EXPECT_GE(usage.m_virtualBytes, usage.m_rssBytes);
+
+    // A fresh anonymous mapping is not resident until its pages are touched, whatever the
+    // allocator would have done with a buffer of the same size.
+    const size_t bufferSize = 16 << 20;
+    Logger::startMemoryRegion("buffer");
+    void* buffer = mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(buffer, MAP_FAILED);
+    std::memset(buffer, 1, bufferSize);
+    {
+        ScopedMemoryRegion region("nested");
+    }
+    Logger::stopMemoryRegion();
+    munmap(buffer, bufferSize);
+
+    Logger::memoryStats(true);
+    Logger::setMemorySampler(std::chrono::milliseconds(5), false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Logger::setMemorySampler(std::chrono::milliseconds(0));
+    const sLogMemoryStats stats = Logger::memoryStats();
+    EXPECT_GE(stats.m_samples, 2u);
+    EXPECT_GE(stats.m_peakRssBytes, stats.m_last.m_rssBytes);
+
+    std::ifstream file(logFilePath);
+    std::string nested;
+    std::string outer;
+    ASSERT_TRUE(std::getline(file, nested));
+    ASSERT_TRUE(std::getline(file, outer));
+    EXPECT_EQ(nested.rfind("[memory]: nested rss=", 0), 0u) << nested;
+    EXPECT_EQ(outer.rfind("[memory]: buffer rss=", 0), 0u) << outer;
+
+    // The buffer is resident while the outer region runs.
+    long long rss = 0;
+    long long growth = 0;
+    ASSERT_EQ(std::sscanf(outer.c_str(), "[memory]: buffer rss=%lldKiB(%lld)", &rss, &growth), 2);
+    EXPECT_GE(growth, 8 * 1024);
+    EXPECT_FALSE(std::getline(file, outer));
+}
+#endif
+
+TEST_F(LoggerTestFixture, TelemetryCountsRecordsAndBytes)
+{
+    Logger::setTelemetry(true);
+    Logger::telemetry(true);
+    Logger::print("first", eLogMsgType::Info);
+    Logger::print("second", eLogMsgType::Info);
+    Logger::print("failure", eLogMsgType::Error);
+    std::thread([]() { Logger::print("other thread", eLogMsgType::Warning); }).join();
+    Logger::reportSuppressed(eLogMsgType::Warning, 5);
+
+    const sLogTelemetry counters = Logger::telemetry(true);
+    Logger::reportTelemetry(false);
+    Logger::setTelemetry(false);
+    Logger::print("not counted", eLogMsgType::Info);
+
+    std::ifstream file(logFilePath, std::ios::binary);
+    std::vector<std::string> lines;
+    uint64_t countedBytes = 0;
+    for (std::string line; std::getline(file, line);)
+    {
+        if (lines.size() < 5)
+            countedBytes += line.size() + 1;
+        lines.push_back(line);
+    }
+
+    EXPECT_EQ(counters.m_records[static_cast<size_t>(eLogMsgType::Info)], 2u);
+    EXPECT_EQ(counters.m_records[static_cast<size_t>(eLogMsgType::Warning)], 2u);
+    EXPECT_EQ(counters.m_records[static_cast<size_t>(eLogMsgType::Error)], 1u);
+    EXPECT_EQ(counters.m_fileWrites, 5u);
+    EXPECT_EQ(counters.m_fileBytes, countedBytes);
+    EXPECT_EQ(counters.m_coutBytes, 0u);
+    EXPECT_EQ(counters.m_suppressed, 5u);
+    ASSERT_EQ(lines.size(), 7u);
+    EXPECT_EQ(lines[5].rfind("[telemetry]: records=0 errors=0 warnings=0 cout=0B", 0), 0u) << lines[5];
+    EXPECT_EQ(Logger::telemetry().m_records[static_cast<size_t>(eLogMsgType::Info)], 0u);
+}
+
+TEST_F(LoggerTestFixture, TelemetryOfFinishedThreads)
+{
+    Logger::adjustSettings(0);
+    Logger::setTelemetry(true);
+    Logger::telemetry(true);
+    for (int round = 0; round < 2; ++round)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i)
+        {
+            threads.emplace_back([]()
+            {
+                for (int j = 0; j < 3; ++j)
+                    Logger::print("worker", eLogMsgType::Info);
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    // The finished threads left their counts behind, and the reset covers them too.
+    const sLogTelemetry counters = Logger::telemetry(true);
+    const sLogTelemetry afterReset = Logger::telemetry();
+    Logger::setTelemetry(false);
+    Logger::adjustSettings(defaultFlags);
+
+    EXPECT_EQ(counters.m_records[static_cast<size_t>(eLogMsgType::Info)], 48u);
+    EXPECT_EQ(afterReset.m_records[static_cast<size_t>(eLogMsgType::Info)], 0u);
+}
+
+TEST_F(LoggerTestFixture, FormatCoreMatchesPrintf)
+{
+    const long long integers[] = { 0, 7, 10, 99, 100, 12345, -1, -100, 4294967296LL, LLONG_MIN, LLONG_MAX };
+    for (long long value : integers)
+    {
+        char text[MaxIntegerChars];
+        EXPECT_EQ(std::string(text, WriteInteger(text, value)), std::to_string(value));
+    }
+    char maxText[MaxIntegerChars];
+    EXPECT_EQ(std::string(maxText, WriteInteger(maxText, UINT64_MAX)), std::to_string(UINT64_MAX));
+
+    const auto checkDeferred = [](const char* format, auto... args) {
+        std::string captured;
+        EncodeLogArgs(captured, args...);
+        std::string text;
+        FormatLogArgs(format, captured.data(), captured.size(), text);
+        char expected[512];
+        std::snprintf(expected, sizeof(expected), format, args...);
+        EXPECT_EQ(text, expected) << format;
+    };
+    const double doubles[] = { 0.0, -0.0, 0.1, 1.0 / 3, 2.5e-300, 1e300, 123456.789, -7.25, 0.5, 2.5 };
+    for (double value : doubles)
+    {
+        char text[MaxShortestChars];
+        EXPECT_EQ(std::strtod(std::string(text, WriteShortest(text, value)).c_str(), nullptr), value);
+        for (const char* format : { "%f", "%.3f", "%.0f", "%e", "%.0e", "%g", "%.10g", "%10.2f" })
+            checkDeferred(format, value);
+    }
+    checkDeferred("%d|%u|%i|%ld|%lld|%llu|%s|%5d|%-4s|%x|%c|%%", -5, 7u, -2147483647 - 1, -3L, LLONG_MIN, ULLONG_MAX, "text", 42, "ab", 255, 'z');
+    checkDeferred("%d %u", 4000000000u, -1);
+
+    std::string text;
+    FormatLog(text, LOG_FORMAT("%f %e %g %x %lld %lu %d"), 2.5, 1e-7, 1e20, 255u, LLONG_MIN, 7ul, 4000000000u);
+    char expected[256];
+    std::snprintf(expected, sizeof(expected), "%f %e %g %x %lld %lu %d", 2.5, 1e-7, 1e20, 255u, LLONG_MIN, 7ul, static_cast<int>(4000000000u));
+    EXPECT_EQ(text, expected);
+}
+
+TEST_F(LoggerTestFixture, AsyncModeWritesAllRecords)
+{
+    Logger::adjustSettings(defaultFlags | eLogSettings::AsyncMode);
+    for (int i = 0; i < 100; ++i)
+        Logger::print("Record " + std::to_string(i));
+    Logger::flush();
+    Logger::adjustSettings(defaultFlags);
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    size_t pos = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        pos = text.find("Record " + std::to_string(i), pos);
+        ASSERT_NE(pos, std::string::npos);
+    }
+}
+
+TEST_F(LoggerTestFixture, AsyncModeDropOldestCountsDrops)
+{
+    constexpr int recordsNum = 1000;
+    const auto droppedBefore = Logger::droppedRecords();
+
+    Logger::setAsyncOptions(2, eLogBackpressure::DropOldest);
+    Logger::adjustSettings(defaultFlags | eLogSettings::AsyncMode);
+    for (int i = 0; i < recordsNum; ++i)
+        Logger::print("Record");
+    Logger::flush();
+    const auto dropped = Logger::droppedRecords() - droppedBefore;
+    Logger::adjustSettings(defaultFlags);
+    Logger::setAsyncOptions(8192, eLogBackpressure::Block);
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    unsigned long long written = 0;
+    for (size_t pos = text.find("Record"); pos != std::string::npos; pos = text.find("Record", pos + 1))
+        ++written;
+    EXPECT_EQ(written + dropped, static_cast<unsigned long long>(recordsNum));
+}
+
+TEST_F(LoggerTestFixture, PrintLongFormattedString)
+{
+    const std::string longText(3000, 'x');
+    Logger::print(eLogMsgType::None, "%s|%d", longText, 5);
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    EXPECT_EQ(text, longText + "|5");
+}
+
+TEST_F(LoggerTestFixture, LongFormatSpecs)
+{
+    const std::string flags(50, '-');
+    const std::string repeatedFlags = "%" + flags + "*.*d|";
+    Logger::print(eLogMsgType::None, repeatedFlags.c_str(), 8, 3, 42);
+    // The widths of INT_MIN take the most room a spec can need.
+    const std::string widest = "%" + std::string(39, '-') + "+ #0'*.*lld|";
+    Logger::print(eLogMsgType::None, widest.c_str(), INT_MIN, INT_MIN, 7LL);
+    Logger::print(eLogMsgType::None, "%12345678901d|%d", 1, 2);
+
+    std::ifstream file(logFilePath);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0], "042     |");
+    EXPECT_EQ(lines[1].back(), '|');
+    EXPECT_EQ(lines[2], "%12345678901d|2");
+}
+
+TEST_F(LoggerTestFixture, DeferredFormatInAsyncMode)
+{
+    Logger::adjustSettings(defaultFlags | eLogSettings::AsyncMode | eLogSettings::DeferredFormat);
+    std::string arg = "text";
+    Logger::print(eLogMsgType::Info, "value %d and %s and %.1f", 7, arg, 2.5);
+    arg = "changed";
+    Logger::flush();
+    Logger::adjustSettings(defaultFlags);
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    EXPECT_EQ(text, "[Info]: value 7 and text and 2.5");
+}
+
+TEST_F(LoggerTestFixture, PrintCheckedFormat)
+{
+    Logger::print(eLogMsgType::None, LOG_FORMAT("int %d, unsigned %u, str %s, [%5.1f] [%-3d] [%*d] %c %%"),
+        -10, 7u, std::string("abc"), 3.14159, 42, 4, 5, 'z');
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    EXPECT_EQ(text, "int -10, unsigned 7, str abc, [  3.1] [42 ] [   5] z %");
+}
+
+TEST_F(LoggerTestFixture, LogLevelFilter)
+{
+    int evaluated = 0;
+    auto message = [&evaluated](const char* text) {
+        ++evaluated;
+        return std::string(text);
+    };
+
+    Logger::setLogLevel(eLogMsgType::Warning);
+    LOG_DEBUG(message("DebugLine"));
+    LOG_INFOF("InfoLine %s", message("arg"));
+    LOG_ERROR(message("ErrorLine"));
+    Logger::print("PlainLine");
+    Logger::setLogLevel(eLogMsgType::Trace);
+    LOG_TRACE(message("TraceLine"));
+
+    EXPECT_EQ(evaluated, 2);
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    EXPECT_EQ(text.find("DebugLine"), std::string::npos);
+    EXPECT_EQ(text.find("InfoLine"), std::string::npos);
+    EXPECT_NE(text.find("[ERROR]: ErrorLine"), std::string::npos);
+    EXPECT_NE(text.find("PlainLine"), std::string::npos);
+    EXPECT_NE(text.find("[Trace]: TraceLine"), std::string::npos);
+}
+
+TEST_F(LoggerTestFixture, RateLimiterRefillsTokens)
+{
+    // Two tokens a second: the sleep refills one token, with half a token to spare either way.
+    sLogRateLimiter limiter(2.0, 2);
+    const auto burst = [&limiter](std::vector<uint64_t>& passed) {
+        for (int i = 0; i < 100; ++i)
+        {
+            uint64_t suppressed = 0;
+            if (limiter.tryPass(suppressed))
+                passed.push_back(suppressed);
+        }
+    };
+    std::vector<uint64_t> first;
+    burst(first);
+    std::this_thread::sleep_for(std::chrono::milliseconds(750));
+    std::vector<uint64_t> second;
+    burst(second);
+
+    EXPECT_EQ(first, std::vector<uint64_t>({ 0, 0 }));
+    EXPECT_EQ(second, std::vector<uint64_t>({ 98 }));
+
+    sLogSampler sampler(10);
+    std::vector<uint64_t> sampled;
+    for (int i = 0; i < 25; ++i)
+    {
+        uint64_t suppressed = 0;
+        if (sampler.tryPass(suppressed))
+            sampled.push_back(suppressed);
+    }
+    EXPECT_EQ(sampled, std::vector<uint64_t>({ 0, 9, 9 }));
+}
+
+TEST_F(LoggerTestFixture, RateLimitedAndSampledCallSites)
+{
+    // The limiters of the call sites keep their state for the life of the process, so the
+    // checks hold however often the test runs.
+    for (int i = 0; i < 30; ++i)
+        LOG_SAMPLEDF(eLogMsgType::Warning, 10, "sampled %d", i);
+    // A token refills every 10 ms.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 100; ++i)
+        LOG_RATE_LIMITED(eLogMsgType::Error, 100, 1, "limited");
+
+    std::ifstream file(logFilePath);
+    std::vector<std::string> sampled;
+    size_t limited = 0;
+    for (std::string line; std::getline(file, line);)
+    {
+        unsigned long long count = 0;
+        if (line.rfind("[Warning]: sampled ", 0) == 0)
+            sampled.push_back(line);
+        else if (std::sscanf(line.c_str(), "[Warning]: suppressed %llu similar messages", &count) == 1)
+            EXPECT_EQ(count, 9u);
+        else if (line == "[ERROR]: limited")
+            ++limited;
+        else if (std::sscanf(line.c_str(), "[ERROR]: suppressed %llu similar messages", &count) == 1)
+            EXPECT_GT(count, 0u);
+        else
+            ADD_FAILURE() << line;
+    }
+    // Every 10th call passes and the passing ones report the nine before them.
+    EXPECT_EQ(sampled, std::vector<std::string>({ "[Warning]: sampled 0", "[Warning]: sampled 10", "[Warning]: sampled 20" }));
+    EXPECT_GE(limited, 1u);
+    EXPECT_LT(limited, 100u);
+}
+
+TEST_F(LoggerTestFixture, FlightRecorderDumpsOnError)
+{
+    const std::string dumpPath = "flight_recorder.txt";
+    std::filesystem::remove(dumpPath);
+    Logger::adjustSettings(0);
+    Logger::setFlightRecorder(1024, dumpPath, true, false);
+    for (int i = 0; i < 1000; ++i)
+        Logger::print(eLogMsgType::Info, LOG_FORMAT("record %d"), i);
+    Logger::print("boom", eLogMsgType::Error);
+    // Nothing new since the dump above.
+    Logger::dumpFlightRecorder();
+    Logger::setFlightRecorder(0, dumpPath);
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(dumpPath);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+    file.close();
+    std::filesystem::remove(dumpPath);
+
+    // The ring holds the last kilobyte, starting at a whole record.
+    ASSERT_GT(lines.size(), 10u);
+    EXPECT_LT(lines.size(), 100u);
+    EXPECT_EQ(lines.front(), "----- flight recorder dump: error -----");
+    EXPECT_EQ(lines[1].compare(0, 15, "[Info]: record "), 0);
+    EXPECT_EQ(lines[lines.size() - 2], "[Info]: record 999");
+    EXPECT_EQ(lines.back(), "[ERROR]: boom");
+}
+
+TEST_F(LoggerTestFixture, FlightRecorderReplacedWhileLogging)
+{
+    const std::string dumpPath = "flight_recorder.txt";
+    std::filesystem::remove(dumpPath);
+    Logger::adjustSettings(0);
+    Logger::setFlightRecorder(1024, dumpPath, false, false);
+    std::atomic<bool> isDone{ false };
+    std::atomic<uint64_t> printed{ 0 };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&isDone, &printed]()
+        {
+            while (!isDone.load())
+            {
+                Logger::print(eLogMsgType::Info, LOG_FORMAT("record %d"), 1);
+                printed.fetch_add(1);
+            }
+        });
+    }
+    // Every replacement deletes the recorder that the threads were just writing to.
+    for (int i = 0; i < 50; ++i)
+    {
+        const uint64_t target = printed.load() + 16;
+        while (printed.load() < target)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        Logger::setFlightRecorder(1024 + i % 2, dumpPath, false, false);
+    }
+    const uint64_t target = printed.load() + 16;
+    while (printed.load() < target)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    isDone.store(true);
+    for (std::thread& thread : threads)
+        thread.join();
+    Logger::dumpFlightRecorder();
+    Logger::setFlightRecorder(0, dumpPath);
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(dumpPath);
+    std::string line;
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, "----- flight recorder dump: request -----");
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, "[Info]: record 1");
+    file.close();
+    std::filesystem::remove(dumpPath);
+}
+
+TEST_F(LoggerTestFixture, FlightRecorderDumpsOnFatalSignal)
+{
+    const std::string dumpPath = "flight_recorder_signal.txt";
+    std::filesystem::remove(dumpPath);
+    EXPECT_DEATH({
+        Logger::adjustSettings(0);
+        Logger::setFlightRecorder(4096, dumpPath);
+        Logger::print("last words", eLogMsgType::Info);
+        std::abort();
+    }, "");
+
+    std::ifstream file(dumpPath);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(dumpPath);
+    EXPECT_EQ(text, "----- flight recorder dump: signal " + std::to_string(SIGABRT) + " -----\n[Info]: last words\n");
+}
+
+#ifndef _WIN32
+TEST_F(LoggerTestFixture, SharedRingKeepsRecordsOfCrashedProcess)
+{
+    const std::string directory = "shared_rings";
+    std::filesystem::remove_all(directory);
+    Logger::setSharedRing(directory, 4096);
+    Logger::print("closed ring", eLogMsgType::Info);
+    Logger::setSharedRing("");
+    EXPECT_DEATH({
+        Logger::adjustSettings(0);
+        Logger::setSharedRing(directory, 4096);
+        Logger::print("published before the crash", eLogMsgType::Error);
+        std::abort();
+    }, "");
+
+    std::vector<sSharedRingRecord> records;
+    size_t rings = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        sSharedRingReader ring(entry.path().string());
+        ASSERT_TRUE(ring.isOpen());
+        EXPECT_TRUE(ring.isFinished());
+        ring.read(records);
+        ++rings;
+    }
+    std::filesystem::remove_all(directory);
+
+    EXPECT_EQ(rings, 2u);
+    ASSERT_EQ(records.size(), 2u);
+    std::sort(records.begin(), records.end(),
+        [](const sSharedRingRecord& left, const sSharedRingRecord& right) { return left.m_time < right.m_time; });
+    EXPECT_EQ(records[0].m_text, "[Info]: closed ring\n");
+    EXPECT_EQ(records[1].m_text, "[ERROR]: published before the crash\n");
+    EXPECT_EQ(records[1].m_type, eLogMsgType::Error);
+    EXPECT_GT(records[0].m_time, 0);
+}
+#endif
+
+TEST_F(LoggerTestFixture, StructuredLayouts)
+{
+    const auto readLines = [this]() {
+        std::ifstream file(logFilePath);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);)
+            lines.push_back(line);
+        return lines;
+    };
+    const auto logRecords = []() {
+        Logger::printFields(eLogMsgType::Info, "request \"done\"\n",
+            { { "status", 200 }, { "path", "/a b" }, { "ms", 2.5 }, { "cached", false } });
+        Logger::startTimer("query");
+        Logger::stopTimer(eLogTimerUnits::Seconds, "rows");
+    };
+
+    Logger::adjustSettings(defaultFlags | eLogSettings::JsonLines);
+    logRecords();
+    const std::vector<std::string> json = readLines();
+    TearDown();
+
+    Logger::adjustSettings(defaultFlags | eLogSettings::Logfmt);
+    logRecords();
+    const std::vector<std::string> logfmt = readLines();
+    Logger::adjustSettings(defaultFlags);
+
+    const std::vector<std::string> expectedJson = {
+        R"({"level":"info","msg":"request \"done\"\n","status":200,"path":"/a b","ms":2.5,"cached":false})",
+        R"({"msg":"query: rows","timer":"query","elapsed":0,"units":"sec","depth":0})",
+    };
+    const std::vector<std::string> expectedLogfmt = {
+        R"(level=info msg="request \"done\"\n" status=200 path="/a b" ms=2.5 cached=false)",
+        R"(msg="query: rows" timer=query elapsed=0 units=sec depth=0)",
+    };
+    EXPECT_EQ(json, expectedJson);
+    EXPECT_EQ(logfmt, expectedLogfmt);
+}
+
+TEST_F(LoggerTestFixture, MappedFileSink)
+{
+    Logger::adjustSettings(eLogSettings::UseFile | eLogSettings::MappedFile);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::print("First mapped line");
+    Logger::print("Second mapped line", eLogMsgType::Warning);
+    // Switching the strategy closes the mapping and truncates the file to its real length.
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(logFilePath, std::ios::binary | std::ios::ate);
+    EXPECT_EQ(static_cast<size_t>(file.tellg()), std::string("First mapped line\n[Warning]: Second mapped line\n").size());
+    file.close();
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    EXPECT_EQ(text, "First mapped line[Warning]: Second mapped line");
+}
+
+TEST_F(LoggerTestFixture, IntervalDurabilityCommitsBufferedRecords)
+{
+    Logger::adjustSettings(eLogSettings::UseFile);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::setDurability(eLogDurability::Interval, 20);
+    Logger::print("Committed without flush");
+
+    // The record stays in the sink buffer until the housekeeper commits it.
+    std::string text;
+    for (int i = 0; i < 100 && text.empty(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        text.clear();
+        GetLogFileText(text);
+    }
+    Logger::setDurability(eLogDurability::None);
+    Logger::adjustSettings(defaultFlags);
+    EXPECT_EQ(text, "Committed without flush");
+}
+
+TEST_F(LoggerTestFixture, EveryNRecordsDurabilityCommitsBatches)
+{
+    Logger::adjustSettings(eLogSettings::UseFile);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::setDurability(eLogDurability::EveryNRecords, 10);
+    Logger::setTelemetry(true);
+    Logger::telemetry(true);
+    for (int i = 0; i < 25; ++i)
+        Logger::print("Batched record " + std::to_string(i));
+
+    // Two batches are committed, the last five records wait in the buffer of the file.
+    const uint64_t syncs = Logger::telemetry(true).m_fileSyncs;
+    std::ifstream file(logFilePath);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+    file.close();
+    Logger::setTelemetry(false);
+    Logger::setDurability(eLogDurability::None);
+    Logger::adjustSettings(defaultFlags);
+
+    EXPECT_EQ(syncs, 2u);
+    ASSERT_EQ(lines.size(), 20u);
+    for (size_t i = 0; i < lines.size(); ++i)
+        EXPECT_EQ(lines[i], "Batched record " + std::to_string(i));
+}
+
+TEST_F(LoggerTestFixture, OnErrorDurabilityCommitsWithTheError)
+{
+    Logger::adjustSettings(eLogSettings::UseFile);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::setDurability(eLogDurability::OnError);
+    Logger::setTelemetry(true);
+    Logger::telemetry(true);
+    for (int i = 0; i < 5; ++i)
+        Logger::print("Before the error " + std::to_string(i), eLogMsgType::Warning);
+    const uint64_t syncsBefore = Logger::telemetry().m_fileSyncs;
+    std::string textBefore;
+    GetLogFileText(textBefore);
+    Logger::print("Failure", eLogMsgType::Error);
+
+    // The error commits the records before it together with itself.
+    const uint64_t syncs = Logger::telemetry(true).m_fileSyncs;
+    std::ifstream file(logFilePath);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+    file.close();
+    Logger::setTelemetry(false);
+    Logger::setDurability(eLogDurability::None);
+    Logger::adjustSettings(defaultFlags);
+
+    EXPECT_EQ(syncsBefore, 0u);
+    EXPECT_EQ(textBefore, "");
+    EXPECT_EQ(syncs, 1u);
+    ASSERT_EQ(lines.size(), 6u);
+    EXPECT_EQ(lines[4], "[Warning]: Before the error 4");
+    EXPECT_EQ(lines[5], "[ERROR]: Failure");
+}
+
+TEST_F(LoggerTestFixture, SizeRotationCompressesAndPrunesFiles)
+{
+    // A file of the user named after the log file is not a rotated file.
+    const std::string backupPath = logFilePath + ".bak";
+    std::ofstream(backupPath) << "backup\n";
+
+    Logger::adjustSettings(eLogSettings::UseFile);
+    Logger::setLogFilePath(logFilePath, false);
+    // Many rotations within one second.
+    Logger::setRotation(1024, std::chrono::seconds(0), 2, true);
+    for (int i = 0; i < 500; ++i)
+        Logger::print("Rotated record " + std::to_string(i));
+    // Turning rotation off waits for the archiver to finish.
+    Logger::setRotation(0);
+    Logger::adjustSettings(defaultFlags);
+
+    EXPECT_TRUE(std::filesystem::exists(backupPath));
+    std::filesystem::remove(backupPath);
+    std::vector<std::filesystem::path> archives;
+    for (const auto& entry : std::filesystem::directory_iterator("."))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(logFilePath + ".", 0) == 0)
+            archives.push_back(entry.path());
+    }
+    ASSERT_EQ(archives.size(), 2u);
+    // Without the extension the names sort in the order of rotation.
+    std::sort(archives.begin(), archives.end(),
+        [](const std::filesystem::path& left, const std::filesystem::path& right) { return left.stem() < right.stem(); });
+
+    // The archives and the live file hold the last records in order.
+    std::string kept;
+    for (const auto& archive : archives)
+    {
+        EXPECT_EQ(archive.extension(), ".lz4");
+        std::ifstream file(archive, std::ios::binary);
+        const std::string frame((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        std::filesystem::remove(archive);
+
+        std::string segment;
+        ASSERT_TRUE(DecodeLz4Frame(frame, segment)) << archive;
+        EXPECT_GE(segment.size(), 1024u);
+        EXPECT_LT(frame.size(), segment.size());
+        kept += segment;
+    }
+    std::ifstream file(logFilePath, std::ios::binary);
+    kept.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    std::string written;
+    for (int i = 0; i < 500; ++i)
+        written += "Rotated record " + std::to_string(i) + "\n";
+    ASSERT_GT(kept.size(), 2048u);
+    ASSERT_LT(kept.size(), written.size());
+    const size_t start = written.size() - kept.size();
+    EXPECT_EQ(written[start - 1], '\n');
+    EXPECT_EQ(kept, written.substr(start));
+}
+
+TEST_F(LoggerTestFixture, LogIndexDescribesBlocks)
+{
+    Logger::adjustSettings(defaultFlags | eLogSettings::ShowTimestamp);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::setLogIndex(1);
+    const std::string text(200, 'x');
+    for (int i = 0; i < 20; ++i)
+        Logger::print(text, i == 12 ? eLogMsgType::Error : eLogMsgType::Info);
+    // Turning the index off writes the entry of the unfinished block.
+    Logger::setLogIndex(0);
+    Logger::adjustSettings(defaultFlags);
+
+    const std::string indexPath = LogIndexPath(logFilePath);
+    std::ifstream file(indexPath, std::ios::binary);
+    const std::string index((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(indexPath);
+
+    std::vector<sLogIndexEntry> entries;
+    ASSERT_TRUE(ReadLogIndex(index.data(), index.size(), entries));
+    // Five records of about 236 bytes fill a block of 1 KiB.
+    ASSERT_EQ(entries.size(), 4u);
+    const uint8_t info = 1u << static_cast<unsigned>(eLogMsgType::Info);
+    const uint8_t error = 1u << static_cast<unsigned>(eLogMsgType::Error);
+    uint64_t end = 0;
+    for (const sLogIndexEntry& entry : entries)
+    {
+        EXPECT_EQ(entry.m_offset, end);
+        EXPECT_GE(entry.m_size, 1024u);
+        EXPECT_LT(entry.m_size, 1024u + 240u);
+        EXPECT_GT(entry.m_minTime, 0);
+        EXPECT_LE(entry.m_minTime, entry.m_maxTime);
+        EXPECT_NE(entry.m_threads, 0u);
+        end = entry.m_offset + entry.m_size;
+    }
+    EXPECT_EQ(end, std::filesystem::file_size(logFilePath));
+    EXPECT_EQ(entries[0].m_levels, info);
+    EXPECT_EQ(entries[2].m_levels, info | error);
+    EXPECT_EQ(entries[3].m_levels, info);
+}
+
+TEST_F(LoggerTestFixture, LogIndexTimesWithoutTimestamps)
+{
+    const auto now = []()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    };
+    // The record of the thread still carries the time of this one.
+    Logger::adjustSettings(defaultFlags | eLogSettings::ShowTimestamp);
+    Logger::print("stamped", eLogMsgType::Info);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    Logger::adjustSettings(defaultFlags);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::setLogIndex(1);
+    const int64_t before = now();
+    Logger::print("plain", eLogMsgType::Info);
+    const int64_t after = now();
+    Logger::setLogIndex(0);
+
+    const std::string indexPath = LogIndexPath(logFilePath);
+    std::ifstream file(indexPath, std::ios::binary);
+    const std::string index((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(indexPath);
+
+    std::vector<sLogIndexEntry> entries;
+    ASSERT_TRUE(ReadLogIndex(index.data(), index.size(), entries));
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_GE(entries[0].m_minTime, before);
+    EXPECT_LE(entries[0].m_maxTime, after);
+}
+
+TEST_F(LoggerTestFixture, BinaryFileDecodesToTextLayout)
+{
+    Logger::adjustSettings(eLogSettings::UseFile | eLogSettings::BinaryFile);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::print(eLogMsgType::Info, LOG_FORMAT("binary %d %s"), 42, "record");
+    Logger::print("plain binary", eLogMsgType::Warning);
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(logFilePath, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    sBinaryLogReader reader(data.data(), data.size());
+    sBinaryLogRecord record;
+    std::string text;
+    while (reader.next(record))
+        AppendTextRecord(record, text);
+    EXPECT_FALSE(reader.isCorrupt());
+    EXPECT_EQ(text, "[Info]: binary 42 record\n[Warning]: plain binary\n");
+}
+
+TEST_F(LoggerTestFixture, BinaryFileReadsInPieces)
+{
+    Logger::adjustSettings(eLogSettings::UseFile | eLogSettings::BinaryFile);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::print(eLogMsgType::Info, LOG_FORMAT("binary %d %s"), 42, "record");
+    Logger::print("plain binary", eLogMsgType::Warning);
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(logFilePath, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    // Every frame is cut off at least once when the log arrives a byte at a time.
+    sBinaryLogReader reader(nullptr, 0, false);
+    sBinaryLogRecord record;
+    std::string text;
+    std::string piece;
+    for (size_t size = 1; size <= data.size(); ++size)
+    {
+        piece.erase(0, piece.size() - reader.unreadSize());
+        piece.push_back(data[size - 1]);
+        reader.refill(piece.data(), piece.size(), size == data.size());
+        while (reader.next(record))
+            AppendTextRecord(record, text);
+        ASSERT_FALSE(reader.isCorrupt());
+    }
+    EXPECT_EQ(reader.unreadSize(), 0u);
+    EXPECT_EQ(text, "[Info]: binary 42 record\n[Warning]: plain binary\n");
+
+    // A frame that is still cut off when the log is complete is damaged.
+    sBinaryLogReader truncated(data.data(), data.size() - 1);
+    while (truncated.next(record))
+    {
+    }
+    EXPECT_TRUE(truncated.isCorrupt());
+}
+
+TEST_F(LoggerTestFixture, AsyncBinaryFileCopiesTemporaryFormats)
+{
+    Logger::adjustSettings(eLogSettings::UseFile | eLogSettings::BinaryFile | eLogSettings::AsyncMode);
+    Logger::setLogFilePath(logFilePath, false);
+    for (int i = 0; i < 3; ++i)
+    {
+        // The format is freed before the writer thread encodes the record.
+        const std::string format = "temporary format number " + std::to_string(i) + " with %d";
+        Logger::print(eLogMsgType::Info, format.c_str(), i);
+    }
+    Logger::print(eLogMsgType::Info, LOG_FORMAT("static %d"), 3);
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(logFilePath, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    sBinaryLogReader reader(data.data(), data.size());
+    sBinaryLogRecord record;
+    std::string text;
+    while (reader.next(record))
+        AppendTextRecord(record, text);
+    EXPECT_FALSE(reader.isCorrupt());
+    EXPECT_EQ(text, "[Info]: temporary format number 0 with 0\n[Info]: temporary format number 1 with 1\n"
+        "[Info]: temporary format number 2 with 2\n[Info]: static 3\n");
+}
+
+TEST_F(LoggerTestFixture, PerThreadFiles)
+{
+    Logger::adjustSettings(eLogSettings::UseFile | eLogSettings::PerThreadFiles);
+    Logger::setLogFilePath(logFilePath, false);
+    std::vector<uint32_t> indexes(2);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < indexes.size(); ++i)
+    {
+        threads.emplace_back([i, &indexes]() {
+            indexes[i] = Logger::threadIndex();
+            Logger::print("thread record " + std::to_string(i), eLogMsgType::Info);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    Logger::adjustSettings(defaultFlags);
+
+    // Every thread closed its own file on exit, the shared file stays empty.
+    std::string text;
+    GetLogFileText(text);
+    EXPECT_EQ(text, "");
+    for (size_t i = 0; i < indexes.size(); ++i)
+    {
+        const std::string path = std::to_string(indexes[i]) + "_" + logFilePath;
+        std::ifstream file(path);
+        std::string line;
+        ASSERT_TRUE(std::getline(file, line)) << path;
+        ASSERT_GT(line.size(), 27u);
+        EXPECT_EQ(line.substr(27), "[Info]: thread record " + std::to_string(i));
+        EXPECT_FALSE(std::getline(file, line));
+        file.close();
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_F(LoggerTestFixture, NestedScopedTimers)
+{
+    {
+        ScopedTimer outer("outer");
+        Logger::startTimer("named");
+        {
+            ScopedTimer inner("inner", eLogTimerUnits::Nanoseconds);
+        }
+        Logger::stopTimer("named", eLogTimerUnits::Microseconds, "done");
+    }
+
+    std::string text;
+    EXPECT_TRUE(GetLogFileText(text));
+    const auto inner = text.find("nanosec]:     inner");
+    const auto named = text.find("microsec]:   named: done");
+    const auto outer = text.find("microsec]: outer");
+    ASSERT_NE(inner, std::string::npos);
+    ASSERT_NE(named, std::string::npos);
+    ASSERT_NE(outer, std::string::npos);
+    EXPECT_LT(inner, named);
+    EXPECT_LT(named, outer);
+}
+
+TEST_F(LoggerTestFixture, AggregatedTimerStats)
+{
+    Logger::timerStats(true);
+    Logger::setTimerAggregation(true);
+    for (int i = 0; i < 100; ++i)
+    {
+        ScopedTimer timer("hot loop");
+    }
+    std::thread([]() { ScopedTimer timer("hot loop"); }).join();
+    const std::vector<sLogTimerStats> stats = Logger::timerStats(true);
+    Logger::reportTimerStats();
+    Logger::setTimerAggregation(false);
+
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].m_label, "hot loop");
+    EXPECT_EQ(stats[0].m_count, 101u);
+    EXPECT_LE(stats[0].m_minNs, stats[0].m_p50Ns);
+    EXPECT_LE(stats[0].m_p50Ns, stats[0].m_p99Ns);
+    EXPECT_LE(stats[0].m_p99Ns, stats[0].m_maxNs);
+
+    // Aggregated timers print nothing, and the reset left nothing to report.
+    std::string text;
+    GetLogFileText(text);
+    EXPECT_EQ(text, "");
+}
+
+TEST_F(LoggerTestFixture, TimerStatsOfFinishedThreads)
+{
+    Logger::timerStats(true);
+    Logger::setTimerAggregation(true);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([]()
+        {
+            for (int j = 0; j < 10; ++j)
+            {
+                ScopedTimer timer("worker");
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    const std::vector<sLogTimerStats> stats = Logger::timerStats(true);
+    const std::vector<sLogTimerStats> afterReset = Logger::timerStats(false);
+    Logger::setTimerAggregation(false);
+
+    // The finished threads left their samples behind, and the reset dropped them.
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].m_label, "worker");
+    EXPECT_EQ(stats[0].m_count, 80u);
+    EXPECT_TRUE(afterReset.empty());
+}
+
+TEST_F(LoggerTestFixture, TscClockTimers)
+{
+    const eLogClock clock = Logger::setClock(eLogClock::Tsc);
+    Logger::timerStats(true);
+    Logger::setTimerAggregation(true);
+    {
+        ScopedTimer timer("sleep");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    const std::vector<sLogTimerStats> stats = Logger::timerStats(true);
+    Logger::setTimerAggregation(false);
+    EXPECT_EQ(Logger::setClock(eLogClock::Steady), eLogClock::Steady);
+
+    // Either the counter or the fallback measures the sleep.
+    EXPECT_TRUE(clock == eLogClock::Tsc || clock == eLogClock::Steady);
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_GE(stats[0].m_maxNs, 19000000u);
+    EXPECT_LT(stats[0].m_maxNs, 2000000000u);
+}
+
+TEST_F(LoggerTestFixture, WallClockTimestampPrefix)
+{
+    Logger::adjustSettings(defaultFlags | eLogSettings::ShowTimestamp);
+    Logger::setLogFilePath(logFilePath, false);
+    Logger::print("first", eLogMsgType::Info);
+    Logger::print("second");
+    Logger::adjustSettings(defaultFlags);
+
+    std::ifstream file(logFilePath);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+
+    const std::regex stamp(R"(\d{4}-\d{2}-\d{2} \d{2}:\d{2}:\d{2}\.\d{6} )");
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_TRUE(std::regex_match(lines[0].substr(0, 27), stamp));
+    EXPECT_EQ(lines[0].substr(27), "[Info]: first");
+    EXPECT_TRUE(std::regex_match(lines[1].substr(0, 27), stamp));
+    EXPECT_EQ(lines[1].substr(27), "second");
+    EXPECT_LE(lines[0].substr(0, 27), lines[1].substr(0, 27));
+}
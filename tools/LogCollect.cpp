@@ -0,0 +1,241 @@
+/**
+ * @file LogCollect.cpp
+ * @brief Drains the shared-memory rings of the processes (Logger::setSharedRing) into one log ordered by time.
+ */
+
+#include "LogLines.h"
+#include "SharedRing.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+#define POLL_INTERVAL_MS 10
+#define DEFAULT_DELAY_MS 100
+
+    namespace fs = std::filesystem;
+
+    struct sOptions
+    {
+        std::string m_directory;
+        std::string m_outputPath;
+        int64_t m_delayUs = DEFAULT_DELAY_MS * 1000;
+        bool m_once = false;
+        bool m_showProcessID = false;
+    };
+
+    struct sPending
+    {
+        int64_t m_time;
+        uint64_t m_sequence;   //!< Order of arrival, keeps the records of equal times in order
+        std::string m_text;
+    };
+
+    struct sLaterRecord
+    {
+        bool operator()(const sPending& left, const sPending& right) const
+        {
+            return left.m_time != right.m_time ? left.m_time > right.m_time : left.m_sequence > right.m_sequence;
+        }
+    };
+
+    volatile std::sig_atomic_t g_stop = 0;
+
+    void OnStop(int)
+    {
+        g_stop = 1;
+    }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: logcollect [options] <directory>\n"
+            "Drains the shared-memory rings that the processes create in the directory with\n"
+            "Logger::setSharedRing into one log ordered by the record times, until it is stopped.\n"
+            "The rings of finished or crashed processes are drained and removed.\n"
+            "  -o <output>      Append to the file instead of writing to the standard output\n"
+            "  --delay <ms>     Hold records back this long to order them across processes (%d)\n"
+            "  --once           Drain the rings once and exit\n"
+            "  --pids           Start every line with the process ID\n", DEFAULT_DELAY_MS);
+    }
+
+    bool ParseOptions(int argc, char** argv, sOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "-o") == 0 && hasValue)
+                options.m_outputPath = argv[++i];
+            else if (std::strcmp(argv[i], "--delay") == 0 && hasValue)
+            {
+                char* end = nullptr;
+                const long long delay = std::strtoll(argv[++i], &end, 10);
+                if (!end || *end != '\0' || delay < 0)
+                    return false;
+                options.m_delayUs = static_cast<int64_t>(delay) * 1000;
+            }
+            else if (std::strcmp(argv[i], "--once") == 0)
+                options.m_once = true;
+            else if (std::strcmp(argv[i], "--pids") == 0)
+                options.m_showProcessID = true;
+            else if (argv[i][0] == '-' || !options.m_directory.empty())
+                return false;
+            else
+                options.m_directory = argv[i];
+        }
+        return !options.m_directory.empty();
+    }
+
+    int64_t NowMicroseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    struct sCollector
+    {
+        sCollector(const sOptions& options, std::FILE* out)
+            : m_options(options)
+            , m_out(out)
+        {
+        }
+
+        // Opens the rings that appeared since the last call.
+        void discover()
+        {
+            std::error_code error;
+            for (fs::directory_iterator it(m_options.m_directory, error), end; !error && it != end; it.increment(error))
+            {
+                const std::string path = it->path().string();
+                if (it->path().extension() != SharedRingExtension || m_rings.count(path) > 0)
+                    continue;
+                auto upRing = std::make_unique<sSharedRingReader>(path);
+                if (upRing->isOpen())
+                    m_rings.emplace(path, std::move(upRing));
+            }
+        }
+
+        // Reads every ring and removes the ones whose process is gone.
+        size_t drain()
+        {
+            size_t count = 0;
+            for (auto it = m_rings.begin(); it != m_rings.end();)
+            {
+                sSharedRingReader& ring = *it->second;
+                // Checked before the read, so the records published before the end are not missed.
+                const bool isFinished = ring.isFinished();
+                m_records.clear();
+                count += ring.read(m_records);
+                for (sSharedRingRecord& record : m_records)
+                    add(ring.processID(), record);
+
+                if (!isFinished)
+                {
+                    ++it;
+                    continue;
+                }
+                if (ring.dropped() > 0)
+                {
+                    std::fprintf(stderr, "logcollect: process %llu dropped %llu records\n",
+                        static_cast<unsigned long long>(ring.processID()), static_cast<unsigned long long>(ring.dropped()));
+                }
+                std::error_code error;
+                fs::remove(it->first, error);
+                it = m_rings.erase(it);
+            }
+            return count;
+        }
+
+        // Writes the records older than the cutoff in time order.
+        void emit(int64_t cutoff)
+        {
+            while (!m_pending.empty() && m_pending.top().m_time <= cutoff)
+            {
+                m_buffer += m_pending.top().m_text;
+                m_pending.pop();
+                if (m_buffer.size() >= OutputBufferSize)
+                    flush();
+            }
+            flush();
+        }
+
+    private:
+        void add(uint64_t processID, sSharedRingRecord& record)
+        {
+            sPending pending{ record.m_time, m_sequence++, std::string() };
+            if (m_options.m_showProcessID)
+                pending.m_text = std::to_string(processID) + " " + record.m_text;
+            else
+                pending.m_text = std::move(record.m_text);
+            m_pending.push(std::move(pending));
+        }
+
+        void flush()
+        {
+            if (m_buffer.empty())
+                return;
+            std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_out);
+            std::fflush(m_out);
+            m_buffer.clear();
+        }
+
+        const sOptions& m_options;
+        std::FILE* m_out;
+        std::map<std::string, std::unique_ptr<sSharedRingReader>> m_rings;
+        std::vector<sSharedRingRecord> m_records;
+        std::priority_queue<sPending, std::vector<sPending>, sLaterRecord> m_pending;
+        uint64_t m_sequence = 0;
+        std::string m_buffer;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    sOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::FILE* out = options.m_outputPath.empty() ? stdout : std::fopen(options.m_outputPath.c_str(), "ab");
+    if (!out)
+    {
+        std::fprintf(stderr, "logcollect: cannot open %s\n", options.m_outputPath.c_str());
+        return 1;
+    }
+    std::signal(SIGINT, OnStop);
+    std::signal(SIGTERM, OnStop);
+
+    sCollector collector(options, out);
+    while (!g_stop && !options.m_once)
+    {
+        // Taken before the rings are read: a record older than the cutoff was published
+        // before the drain started, unless its process stalled longer than the delay.
+        const int64_t cutoff = NowMicroseconds() - options.m_delayUs;
+        collector.discover();
+        const size_t count = collector.drain();
+        collector.emit(cutoff);
+        if (count == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+    }
+    // The records still held back are written before the collector exits.
+    collector.discover();
+    collector.drain();
+    collector.emit(INT64_MAX);
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file LogDecode.cpp
+ * @brief Turns binary log files (eLogSettings::BinaryFile) back into the text layout.
+ */
+
+#include "BinaryLog.h"
+#include "LogLines.h"
+#include "Logger.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct sOptions
+    {
+        eLogMsgType m_minLevel = eLogMsgType::Trace;
+        int64_t m_from = INT64_MIN;   //!< Microseconds since the Unix epoch
+        int64_t m_to = INT64_MAX;
+        bool m_showTime = false;
+        std::vector<std::string> m_files;
+    };
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: logdecode [options] <file>...\n"
+            "  --level <Trace|Debug|Info|Warning|Error>  Skip records below this level\n"
+            "  --from <time>    Skip records older than the time\n"
+            "  --to <time>      Skip records newer than the time\n"
+            "  --timestamps     Start every line with the time of the record\n"
+            "Times are seconds since the Unix epoch or local \"YYYY-MM-DD HH:MM:SS\".\n");
+    }
+
+    bool ParseOptions(int argc, char** argv, sOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--level") == 0 && hasValue)
+            {
+                if (!ParseLevel(argv[++i], options.m_minLevel))
+                    return false;
+            }
+            else if (std::strcmp(argv[i], "--from") == 0 && hasValue)
+            {
+                if (!ParseTime(argv[++i], options.m_from))
+                    return false;
+            }
+            else if (std::strcmp(argv[i], "--to") == 0 && hasValue)
+            {
+                if (!ParseTime(argv[++i], options.m_to))
+                    return false;
+            }
+            else if (std::strcmp(argv[i], "--timestamps") == 0)
+                options.m_showTime = true;
+            else if (argv[i][0] == '-')
+                return false;
+            else
+                options.m_files.push_back(argv[i]);
+        }
+        return !options.m_files.empty();
+    }
+
+    void WriteOut(std::string& out)
+    {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        out.clear();
+    }
+
+    bool DecodeFile(const std::string& path, const sOptions& options)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::fprintf(stderr, "logdecode: cannot open %s\n", path.c_str());
+            return false;
+        }
+        const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        sBinaryLogReader reader(data.data(), data.size());
+        sBinaryLogRecord record;
+        std::string out;
+        while (reader.next(record))
+        {
+            if (Logger::severity(record.m_type) < Logger::severity(options.m_minLevel)
+                || record.m_time < options.m_from || record.m_time > options.m_to)
+                continue;
+            if (options.m_showTime)
+                AppendRecordTime(record.m_time, out);
+            AppendTextRecord(record, out);
+            if (out.size() >= OutputBufferSize)
+                WriteOut(out);
+        }
+        WriteOut(out);
+
+        if (reader.isCorrupt())
+        {
+            std::fprintf(stderr, "logdecode: %s is damaged, stopped at the first bad frame\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    sOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    bool isOk = true;
+    for (const std::string& path : options.m_files)
+        isOk = DecodeFile(path, options) && isOk;
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file LogLines.h
+ * @brief Helpers shared by the tools that read the text lines of the logger.
+ */
+
+#pragma once
+
+#include "Logger.h"
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+
+/**
+ * @brief Bytes the tools collect before they write them out.
+ */
+inline constexpr size_t OutputBufferSize = 64 * 1024;
+
+/**
+ * @brief Length of a timestamp, "YYYY-MM-DD HH:MM:SS.uuuuuu".
+ */
+inline constexpr size_t TimestampKeyLength = 26;
+
+/**
+ * @brief Parses the --level option of the tools, the name of an eLogMsgType other than None.
+ */
+inline bool ParseLevel(const char* text, eLogMsgType& level)
+{
+    static const char* const names[] = { "None", "Trace", "Debug", "Info", "Warning", "Error" };
+    for (size_t i = 1; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        if (std::strcmp(text, names[i]) == 0)
+        {
+            level = static_cast<eLogMsgType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parses the --from and --to options of the tools: seconds since the Unix epoch or
+ * local "YYYY-MM-DD HH:MM:SS".
+ */
+inline bool ParseTime(const char* text, int64_t& microseconds)
+{
+    char* end = nullptr;
+    const long long seconds = std::strtoll(text, &end, 10);
+    if (end && *end == '\0' && end != text)
+    {
+        microseconds = static_cast<int64_t>(seconds) * 1000000;
+        return true;
+    }
+
+    std::tm local = {};
+    std::istringstream stream(text);
+    stream >> std::get_time(&local, "%Y-%m-%d %H:%M:%S");
+    if (stream.fail())
+        return false;
+    local.tm_isdst = -1;
+    microseconds = static_cast<int64_t>(std::mktime(&local)) * 1000000;
+    return true;
+}
+
+/**
+ * @brief Offset of the timestamp: at the start of a text line, after the ts key in JSON and logfmt.
+ */
+inline size_t TimestampOffset(std::string_view line)
+{
+    constexpr std::string_view jsonKey = "{\"ts\":\"";
+    constexpr std::string_view logfmtKey = "ts=";
+    if (line.substr(0, jsonKey.size()) == jsonKey)
+        return jsonKey.size();
+    if (line.substr(0, logfmtKey.size()) == logfmtKey)
+        return logfmtKey.size();
+    return 0;
+}
+
+/**
+ * @brief Returns the timestamp of the line, copied to the key with a space between date and time.
+ * @return Empty if the line has no timestamp. The structured layouts put a 'T' between date and time.
+ */
+inline std::string_view LineTimestamp(std::string_view line, char (&key)[TimestampKeyLength])
+{
+    static const char pattern[] = "dddd-dd-dd dd:dd:dd.dddddd";
+    const size_t offset = TimestampOffset(line);
+    if (line.size() < offset + TimestampKeyLength)
+        return {};
+    for (size_t i = 0; i < TimestampKeyLength; ++i)
+    {
+        const char c = line[offset + i];
+        const bool isDigit = std::isdigit(static_cast<unsigned char>(c)) != 0;
+        if (pattern[i] == 'd' ? !isDigit : c != pattern[i] && !(pattern[i] == ' ' && c == 'T'))
+            return {};
+        key[i] = c;
+    }
+    key[10] = ' ';
+    return std::string_view(key, TimestampKeyLength);
+}
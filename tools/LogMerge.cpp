@@ -0,0 +1,251 @@
+/**
+ * @file LogMerge.cpp
+ * @brief Merges the per-thread log files (eLogSettings::PerThreadFiles) into one log ordered by time.
+ */
+
+#include "BinaryLog.h"
+#include "LogLines.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace
+{
+#define BINARY_LOG_SIGNATURE "\0SLOG"
+#define BINARY_LOG_SIGNATURE_LENGTH 5
+#define BINARY_READ_SIZE (1 << 20)
+#define MAX_BINARY_FRAME_SIZE (64 << 20)
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: logmerge [-o <output>] <file>...\n"
+            "Merges log files written with eLogSettings::PerThreadFiles into one log ordered by\n"
+            "the record timestamps. Binary files are decoded, both kinds are read as a stream.\n"
+            "  -o <output>      Write to the file instead of the standard output\n");
+    }
+
+    bool HasTimestamp(const std::string& line)
+    {
+        char key[TimestampKeyLength];
+        return !LineTimestamp(line, key).empty();
+    }
+
+    /**
+     * @brief A log file read one record at a time.
+     */
+    struct sInput
+    {
+        virtual ~sInput() = default;
+
+        /**
+         * @brief Replaces record with the next record, including its line breaks.
+         * @return false at the end of the file.
+         */
+        virtual bool next(std::string& record) = 0;
+    };
+
+    // Lines without a timestamp continue the record before them, e.g. a multi-line object.
+    struct sTextInput : sInput
+    {
+        explicit sTextInput(std::ifstream&& file)
+            : m_file(std::move(file))
+        {
+            m_hasLine = static_cast<bool>(std::getline(m_file, m_line));
+        }
+
+        bool next(std::string& record) override
+        {
+            if (!m_hasLine)
+                return false;
+            record.assign(m_line);
+            record.push_back('\n');
+            while ((m_hasLine = static_cast<bool>(std::getline(m_file, m_line))) && !HasTimestamp(m_line))
+            {
+                record.append(m_line);
+                record.push_back('\n');
+            }
+            return true;
+        }
+
+    private:
+        std::ifstream m_file;
+        std::string m_line;
+        bool m_hasLine = false;
+    };
+
+    // Read in pieces of BINARY_READ_SIZE, so a file holds about one piece in memory. A frame
+    // that does not read within MAX_BINARY_FRAME_SIZE counts as damaged.
+    struct sBinaryInput : sInput
+    {
+        sBinaryInput(std::ifstream&& file, const std::string& path)
+            : m_file(std::move(file))
+            , m_reader(nullptr, 0, false)
+            , m_path(path)
+        {
+        }
+
+        ~sBinaryInput() override
+        {
+            // Bytes left after the end of the file belong to a frame that did not read.
+            if (m_reader.isCorrupt() || m_reader.unreadSize() != 0)
+                std::fprintf(stderr, "logmerge: %s is damaged, stopped at the first bad frame\n", m_path.c_str());
+        }
+
+        bool next(std::string& record) override
+        {
+            while (!m_reader.next(m_record))
+            {
+                if (m_reader.isCorrupt() || !readMore())
+                    return false;
+            }
+            record.clear();
+            AppendRecordTime(m_record.m_time, record);
+            AppendTextRecord(m_record, record);
+            return true;
+        }
+
+    private:
+        // Keeps the unread bytes and appends the next piece of the file.
+        bool readMore()
+        {
+            const size_t unread = m_reader.unreadSize();
+            if (m_isLastPiece || unread >= MAX_BINARY_FRAME_SIZE)
+                return false;
+            m_data.erase(0, m_data.size() - unread);
+            m_data.resize(unread + BINARY_READ_SIZE);
+            m_file.read(&m_data[unread], BINARY_READ_SIZE);
+            m_data.resize(unread + static_cast<size_t>(m_file.gcount()));
+            m_isLastPiece = !m_file;
+            m_reader.refill(m_data.data(), m_data.size(), m_isLastPiece);
+            return true;
+        }
+
+        std::ifstream m_file;
+        std::string m_data;
+        bool m_isLastPiece = false;
+        sBinaryLogReader m_reader;
+        sBinaryLogRecord m_record;
+        std::string m_path;
+    };
+
+    std::unique_ptr<sInput> OpenInput(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::fprintf(stderr, "logmerge: cannot open %s\n", path.c_str());
+            return nullptr;
+        }
+
+        char signature[BINARY_LOG_SIGNATURE_LENGTH] = {};
+        file.read(signature, sizeof(signature));
+        const bool isBinary = file.gcount() == BINARY_LOG_SIGNATURE_LENGTH
+            && std::memcmp(signature, BINARY_LOG_SIGNATURE, BINARY_LOG_SIGNATURE_LENGTH) == 0;
+        file.clear();
+        file.seekg(0);
+        if (!isBinary)
+            return std::make_unique<sTextInput>(std::move(file));
+
+        return std::make_unique<sBinaryInput>(std::move(file), path);
+    }
+
+    struct sHead
+    {
+        std::string m_key;   //!< Timestamp of the record, empty if it has none
+        size_t m_input;
+    };
+
+    // Orders the heap by time, the records of equal times in the order of the files.
+    struct sLaterHead
+    {
+        bool operator()(const sHead& left, const sHead& right) const
+        {
+            return left.m_key != right.m_key ? left.m_key > right.m_key : left.m_input > right.m_input;
+        }
+    };
+
+    std::string KeyOf(const std::string& record)
+    {
+        char key[TimestampKeyLength];
+        return std::string(LineTimestamp(record, key));
+    }
+
+    // Streaming k-way merge: holds one record per file.
+    void Merge(std::vector<std::unique_ptr<sInput>>& inputs, std::FILE* out)
+    {
+        std::vector<std::string> records(inputs.size());
+        std::priority_queue<sHead, std::vector<sHead>, sLaterHead> heads;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (inputs[i]->next(records[i]))
+                heads.push({ KeyOf(records[i]), i });
+        }
+
+        std::string buffer;
+        while (!heads.empty())
+        {
+            const size_t input = heads.top().m_input;
+            heads.pop();
+            buffer.append(records[input]);
+            if (buffer.size() >= OutputBufferSize)
+            {
+                std::fwrite(buffer.data(), 1, buffer.size(), out);
+                buffer.clear();
+            }
+            if (inputs[input]->next(records[input]))
+                heads.push({ KeyOf(records[input]), input });
+        }
+        std::fwrite(buffer.data(), 1, buffer.size(), out);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string outputPath;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            PrintUsage();
+            return 2;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    bool isOk = true;
+    std::vector<std::unique_ptr<sInput>> inputs;
+    for (const std::string& path : paths)
+    {
+        std::unique_ptr<sInput> input = OpenInput(path);
+        if (input)
+            inputs.push_back(std::move(input));
+        else
+            isOk = false;
+    }
+
+    std::FILE* out = outputPath.empty() ? stdout : std::fopen(outputPath.c_str(), "wb");
+    if (!out)
+    {
+        std::fprintf(stderr, "logmerge: cannot create %s\n", outputPath.c_str());
+        return 1;
+    }
+    Merge(inputs, out);
+    if (out != stdout)
+        std::fclose(out);
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,428 @@
+/**
+ * @file LogSearch.cpp
+ * @brief Searches text log files, skipping the blocks that their index (Logger::setLogIndex) rules out.
+ */
+
+#include "BinaryLog.h"
+#include "LogIndex.h"
+#include "LogLines.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+#define LEVEL_COUNT 6
+
+    struct sOptions
+    {
+        eLogMsgType m_minLevel = eLogMsgType::Trace;
+        int64_t m_from = INT64_MIN;   //!< Microseconds since the Unix epoch
+        int64_t m_to = INT64_MAX;
+        std::string m_text;
+        bool m_showStats = false;
+        std::vector<std::string> m_files;
+    };
+
+    // The query turned into what the blocks and the lines are compared with.
+    struct sQuery
+    {
+        const sOptions* m_options = nullptr;
+        uint8_t m_levels = 0;          //!< Bit per eLogMsgType that passes the level
+        bool m_hasTimeWindow = false;
+        std::string m_fromText;        //!< Bounds of the window in the timestamp layout of the lines
+        std::string m_toText;
+    };
+
+    struct sSearchStats
+    {
+        size_t m_blocks = 0;
+        size_t m_skippedBlocks = 0;
+        uint64_t m_scannedBytes = 0;
+        uint64_t m_skippedBytes = 0;
+    };
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: logsearch [options] <file>...\n"
+            "Prints the lines of text log files that match all the options. Blocks that the\n"
+            "index of a file (\"<file>.idx\") rules out are not read at all.\n"
+            "  --match <text>   Lines that contain the text\n"
+            "  --level <Trace|Debug|Info|Warning|Error>  Skip lines below this level\n"
+            "  --from <time>    Skip lines older than the time\n"
+            "  --to <time>      Skip lines newer than the time\n"
+            "  --stats          Print the scanned and skipped blocks to the standard error\n"
+            "Times are seconds since the Unix epoch or local \"YYYY-MM-DD HH:MM:SS\". With a time\n"
+            "window, lines without a timestamp are skipped.\n");
+    }
+
+    bool ParseOptions(int argc, char** argv, sOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--match") == 0 && hasValue)
+                options.m_text = argv[++i];
+            else if (std::strcmp(argv[i], "--level") == 0 && hasValue)
+            {
+                if (!ParseLevel(argv[++i], options.m_minLevel))
+                    return false;
+            }
+            else if (std::strcmp(argv[i], "--from") == 0 && hasValue)
+            {
+                if (!ParseTime(argv[++i], options.m_from))
+                    return false;
+            }
+            else if (std::strcmp(argv[i], "--to") == 0 && hasValue)
+            {
+                if (!ParseTime(argv[++i], options.m_to))
+                    return false;
+            }
+            else if (std::strcmp(argv[i], "--stats") == 0)
+                options.m_showStats = true;
+            else if (argv[i][0] == '-')
+                return false;
+            else
+                options.m_files.push_back(argv[i]);
+        }
+        return !options.m_files.empty();
+    }
+
+    // "YYYY-MM-DD HH:MM:SS.uuuuuu" in local time, like the timestamps of the logger.
+    std::string TimestampKey(int64_t microseconds)
+    {
+        std::string key;
+        AppendRecordTime(microseconds, key);
+        key.pop_back();
+        return key;
+    }
+
+    sQuery MakeQuery(const sOptions& options)
+    {
+        sQuery query;
+        query.m_options = &options;
+        // Untagged records have the severity of errors, like in the level filter of the logger.
+        for (size_t i = 0; i < LEVEL_COUNT; ++i)
+        {
+            if (Logger::severity(static_cast<eLogMsgType>(i)) >= Logger::severity(options.m_minLevel))
+                query.m_levels |= static_cast<uint8_t>(1u << i);
+        }
+        query.m_hasTimeWindow = options.m_from != INT64_MIN || options.m_to != INT64_MAX;
+        // The dates of the epoch limits have no four-digit year, so they get plain bounds.
+        query.m_fromText = options.m_from == INT64_MIN ? std::string() : TimestampKey(options.m_from);
+        query.m_toText = options.m_to == INT64_MAX ? std::string(TimestampKeyLength, '\x7f') : TimestampKey(options.m_to);
+        return query;
+    }
+
+    bool StartsWith(std::string_view text, std::string_view prefix)
+    {
+        return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    eLogMsgType LevelOfName(std::string_view name)
+    {
+        static const char* const names[] = { "", "trace", "debug", "info", "warning", "error" };
+        for (size_t i = 1; i < LEVEL_COUNT; ++i)
+        {
+            if (StartsWith(name, names[i]))
+                return static_cast<eLogMsgType>(i);
+        }
+        return eLogMsgType::None;
+    }
+
+    // The level from the tag of a text line or the level field of a structured one.
+    eLogMsgType LineLevel(std::string_view line)
+    {
+        if (StartsWith(line, "{") || StartsWith(line, "ts=") || StartsWith(line, "level="))
+        {
+            const std::string_view key = line[0] == '{' ? std::string_view("\"level\":\"") : std::string_view("level=");
+            const size_t pos = line.find(key);
+            return pos == std::string_view::npos ? eLogMsgType::None : LevelOfName(line.substr(pos + key.size()));
+        }
+
+        char key[TimestampKeyLength];
+        if (!LineTimestamp(line, key).empty())
+            line.remove_prefix(std::min<size_t>(line.size(), TimestampKeyLength + 1));
+        static const char* const tags[] = { "", "[Trace]", "[Debug]", "[Info]", "[Warning]", "[ERROR]" };
+        for (size_t i = 1; i < LEVEL_COUNT; ++i)
+        {
+            if (StartsWith(line, tags[i]))
+                return static_cast<eLogMsgType>(i);
+        }
+        return eLogMsgType::None;
+    }
+
+    bool LineMatches(std::string_view line, const sQuery& query)
+    {
+        if (query.m_levels != (1u << LEVEL_COUNT) - 1
+            && (query.m_levels & (1u << static_cast<unsigned>(LineLevel(line)))) == 0)
+            return false;
+        if (!query.m_hasTimeWindow)
+            return true;
+        char key[TimestampKeyLength];
+        const std::string_view time = LineTimestamp(line, key);
+        return !time.empty() && time >= query.m_fromText && time <= query.m_toText;
+    }
+
+    bool BlockMatches(const sLogIndexEntry& entry, const sQuery& query)
+    {
+        if ((entry.m_levels & query.m_levels) == 0)
+            return false;
+        // A block without times is scanned, its lines cannot pass a time window anyway.
+        if (query.m_hasTimeWindow && entry.m_minTime != 0
+            && (entry.m_maxTime < query.m_options->m_from || entry.m_minTime > query.m_options->m_to))
+            return false;
+        return true;
+    }
+
+    // Finds the text by comparing its first and last characters with 16 positions at a time,
+    // only the candidates where both match are compared in full.
+    const char* FindText(const char* begin, const char* end, std::string_view text)
+    {
+        const size_t length = text.size();
+        if (static_cast<size_t>(end - begin) < length)
+            return end;
+        const char* pos = begin;
+#if defined(__SSE2__)
+        const __m128i first = _mm_set1_epi8(text.front());
+        const __m128i last = _mm_set1_epi8(text.back());
+        for (; pos + length - 1 + 16 <= end; pos += 16)
+        {
+            const __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            const __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + length - 1));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(first, firstBlock), _mm_cmpeq_epi8(last, lastBlock))));
+            while (mask != 0)
+            {
+                const char* candidate = pos + __builtin_ctz(mask);
+                if (std::memcmp(candidate, text.data(), length) == 0)
+                    return candidate;
+                mask &= mask - 1;
+            }
+        }
+#endif
+        const char* const lastStart = end - length;
+        while (pos <= lastStart)
+        {
+            pos = static_cast<const char*>(std::memchr(pos, text.front(), static_cast<size_t>(lastStart - pos) + 1));
+            if (!pos)
+                return end;
+            if (std::memcmp(pos, text.data(), length) == 0)
+                return pos;
+            ++pos;
+        }
+        return end;
+    }
+
+    const char* LineStart(const char* begin, const char* pos)
+    {
+        while (pos > begin && pos[-1] != '\n')
+            --pos;
+        return pos;
+    }
+
+    const char* LineEnd(const char* pos, const char* end)
+    {
+        const auto* newline = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        return newline ? newline + 1 : end;
+    }
+
+    struct sOutput
+    {
+        std::string m_prefix;   //!< File name in front of every line when several files are searched
+        std::string m_buffer;
+
+        void add(std::string_view line)
+        {
+            m_buffer += m_prefix;
+            m_buffer.append(line.data(), line.size());
+            if (line.empty() || line.back() != '\n')
+                m_buffer.push_back('\n');
+            if (m_buffer.size() >= OutputBufferSize)
+                flush();
+        }
+
+        void flush()
+        {
+            std::fwrite(m_buffer.data(), 1, m_buffer.size(), stdout);
+            m_buffer.clear();
+        }
+    };
+
+    // Scans a range that starts at a line boundary.
+    void ScanRange(const char* begin, const char* end, const sQuery& query, sOutput& output)
+    {
+        const std::string& text = query.m_options->m_text;
+        const char* pos = begin;
+        while (pos < end)
+        {
+            const char* lineStart = pos;
+            if (!text.empty())
+            {
+                const char* found = FindText(pos, end, text);
+                if (found == end)
+                    return;
+                lineStart = LineStart(begin, found);
+            }
+            const char* lineEnd = LineEnd(lineStart, end);
+            const std::string_view line(lineStart, static_cast<size_t>(lineEnd - lineStart));
+            if (LineMatches(line, query))
+                output.add(line);
+            pos = lineEnd;
+        }
+    }
+
+    // The contents of a file, mapped where the system allows it.
+    struct sFileView
+    {
+        explicit sFileView(const std::string& path)
+        {
+#ifndef _WIN32
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+            struct stat info = {};
+            if (::fstat(fd, &info) == 0)
+            {
+                m_isOpen = true;
+                m_size = static_cast<size_t>(info.st_size);
+                if (m_size > 0)
+                {
+                    void* view = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (view != MAP_FAILED)
+                    {
+                        ::madvise(view, m_size, MADV_SEQUENTIAL);
+                        m_data = static_cast<const char*>(view);
+                    }
+                    else
+                        m_isOpen = false;
+                }
+            }
+            ::close(fd);
+#else
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open())
+                return;
+            m_contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            m_isOpen = true;
+            m_data = m_contents.data();
+            m_size = m_contents.size();
+#endif
+        }
+
+        ~sFileView()
+        {
+#ifndef _WIN32
+            if (m_data)
+                ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+        }
+
+        sFileView(const sFileView&) = delete;
+        sFileView& operator=(const sFileView&) = delete;
+
+        bool isOpen() const { return m_isOpen; }
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        bool m_isOpen = false;
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        std::string m_contents;
+#endif
+    };
+
+    bool SearchFile(const std::string& path, const sQuery& query, sOutput& output, sSearchStats& stats)
+    {
+        const sFileView log(path);
+        if (!log.isOpen())
+        {
+            std::fprintf(stderr, "logsearch: cannot open %s\n", path.c_str());
+            return false;
+        }
+
+        std::vector<sLogIndexEntry> entries;
+        {
+            std::ifstream file(LogIndexPath(path), std::ios::binary);
+            const std::string index((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (!index.empty() && !ReadLogIndex(index.data(), index.size(), entries))
+                std::fprintf(stderr, "logsearch: %s is not an index, scanning all of %s\n", LogIndexPath(path).c_str(), path.c_str());
+        }
+
+        // The gaps between the indexed blocks and the tail that is not indexed yet are always scanned.
+        const char* const data = log.data();
+        uint64_t pos = 0;
+        for (const sLogIndexEntry& entry : entries)
+        {
+            if (entry.m_offset < pos || entry.m_size > log.size() || entry.m_offset > log.size() - entry.m_size)
+                continue;
+            ScanRange(data + pos, data + entry.m_offset, query, output);
+            stats.m_scannedBytes += entry.m_offset - pos;
+            ++stats.m_blocks;
+            if (BlockMatches(entry, query))
+            {
+                ScanRange(data + entry.m_offset, data + entry.m_offset + entry.m_size, query, output);
+                stats.m_scannedBytes += entry.m_size;
+            }
+            else
+            {
+                ++stats.m_skippedBlocks;
+                stats.m_skippedBytes += entry.m_size;
+            }
+            pos = entry.m_offset + entry.m_size;
+        }
+        ScanRange(data + pos, data + log.size(), query, output);
+        stats.m_scannedBytes += log.size() - pos;
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    sOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    const sQuery query = MakeQuery(options);
+    sOutput output;
+    bool isOk = true;
+    for (const std::string& path : options.m_files)
+    {
+        if (options.m_files.size() > 1)
+            output.m_prefix = path + ":";
+        sSearchStats stats;
+        isOk = SearchFile(path, query, output, stats) && isOk;
+        if (options.m_showStats)
+        {
+            std::fprintf(stderr, "logsearch: %s: %zu of %zu blocks skipped, %llu bytes scanned, %llu skipped\n",
+                path.c_str(), stats.m_skippedBlocks, stats.m_blocks,
+                static_cast<unsigned long long>(stats.m_scannedBytes), static_cast<unsigned long long>(stats.m_skippedBytes));
+        }
+    }
+    output.flush();
+    return isOk ? 0 : 1;
+}